@@ -83,6 +83,35 @@ extern void snowshoe_neg(const char P[64], char R[64]);
  */
 extern int snowshoe_valid(const char P[64]);
 
+/*
+ * Structure-of-arrays (SoA) point blocks
+ *
+ * Batch functions that end in _soa take points in blocks of 8, 512 bytes
+ * each.  A block is 8 rows of 64-bit little-endian words, one row per limb
+ * of the point (x.a low, x.a high, x.b low, x.b high, y.a low, ...), with
+ * one column per point.  So word w of point i is at 64-bit offset
+ * (i / 8) * 64 + w * 8 + (i % 8).  The unused columns of the last block
+ * are zero.
+ *
+ * Buffers for n points must have room for (n + 7) / 8 blocks.
+ */
+
+/*
+ * Convert n points from the usual 64-byte format to SoA blocks
+ */
+extern void snowshoe_xy_to_soa(const char *P, int n, char *B);
+
+/*
+ * Convert n points from SoA blocks to the usual 64-byte format
+ */
+extern void snowshoe_soa_to_xy(const char *B, int n, char *P);
+
+/*
+ * Returns 0 if all n points in the SoA blocks are valid.
+ * Returns non-zero if any of the points are not on the curve.
+ */
+extern int snowshoe_valid_soa(const char *B, int n);
+
 /*
  * R = k*[4]*G
  *
@@ -154,6 +183,47 @@ extern int snowshoe_simul_gen(const char a[32], const char b[32], const char Q[6
  */
 extern int snowshoe_simul(const char a[32], const char P[64], const char b[32], const char Q[64], char R[64]);
 
+/*
+ * Short scalar multiplication
+ *
+ * A 16-byte short scalar s holds two 64-bit little-endian words s0, s1,
+ * and stands for the scalar k = s0 + s1 * lambda (mod q), where lambda is
+ * the eigenvalue of the curve endomorphism.  The multiplication skips the
+ * scalar decomposition and runs half as many doublings, so it takes about
+ * half the time of snowshoe_mul() and snowshoe_simul().
+ *
+ * Random short scalars have 128 bits of entropy, which is enough for batch
+ * verification coefficients, identification challenges and blinding
+ * factors.  Fill s with random bytes and use snowshoe_short_scalar() to get
+ * k wherever the rest of the protocol needs it (e.g. snowshoe_mul_mod_q).
+ *
+ * s0 must not be zero.
+ */
+
+/*
+ * k = s0 + s1 * lambda (mod q)
+ *
+ * Returns 0 on success.
+ * Returns non-zero if s0 is zero.
+ */
+extern int snowshoe_short_scalar(const char s[16], char k[32]);
+
+/*
+ * R = 4kP, for k from the short scalar s
+ *
+ * Returns 0 on success.
+ * Returns non-zero if s0 is zero or P is invalid.
+ */
+extern int snowshoe_mul_short(const char s[16], const char P[64], char R[64]);
+
+/*
+ * R = 4aP + 4bQ, for a and b from the short scalars sa and sb
+ *
+ * Returns 0 on success.
+ * Returns non-zero if either s0 is zero or P or Q is invalid.
+ */
+extern int snowshoe_simul_short(const char sa[16], const char P[64], const char sb[16], const char Q[64], char R[64]);
+
 /*
  * E = Elligator(key)
  *
@@ -165,6 +235,107 @@ extern int snowshoe_simul(const char a[32], const char P[64], const char b[32],
  */
 extern int snowshoe_elligator(const char key[32], char E[128]);
 
+/*
+ * E[i] = Elligator(keys[i]), for i = 0..n-1
+ *
+ * Same as snowshoe_elligator for n keys, 32 bytes apart, writing n points
+ * 128 bytes apart.  This is much faster than calling snowshoe_elligator
+ * in a loop because the field inversions are shared across the batch.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if any of the keys produced an invalid point.
+ * The output for each invalid key is set to all zeroes, and the rest of the
+ * outputs are still valid.
+ */
+extern int snowshoe_elligator_batch(const char *keys, int n, char *E);
+
+/*
+ * R = HashToCurve(h)
+ *
+ * Hash to a curve point suitable as a random oracle, for protocols like
+ * VOPRF and blind tokens.  h is 64 bytes of hash output, for example from
+ * BLAKE2b over a domain separation tag and the message.  The result is:
+ *
+ * R = 4 * (Elligator(h[0..31]) + Elligator(h[32..63]))
+ *
+ * Both maps are evaluated in projective form with one final inversion.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if the result is invalid, which is extremely unlikely.
+ */
+extern int snowshoe_hash_to_curve(const char h[64], char R[64]);
+
+/*
+ * R[i] = HashToCurve(h[i]), for i = 0..n-1
+ *
+ * Same as snowshoe_hash_to_curve for n hashes, 64 bytes apart, writing n
+ * points 64 bytes apart.  The final inversions are shared across the batch.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if any of the results are invalid.
+ * The output for each invalid result is set to all zeroes.
+ */
+extern int snowshoe_hash_to_curve_batch(const char *h, int n, char *R);
+
+/*
+ * Same as snowshoe_hash_to_curve_batch, writing the n points to SoA blocks.
+ */
+extern int snowshoe_hash_to_curve_batch_soa(const char *h, int n, char *B);
+
+/*
+ * R = Elligator^-1(P)
+ *
+ * Find a 32-byte representative R of the curve point P, such that
+ * snowshoe_elligator_decode(R) = P.  Representatives are indistinguishable
+ * from uniformly random bytes, which is useful for hiding public keys.
+ *
+ * noise: Random value.  The low 4 bits select one of the representatives.
+ *
+ * Only about half of the points have a representative for a given noise
+ * value.  To keep R uniformly distributed, discard P and generate a new
+ * point when this fails, rather than retrying with a different noise value.
+ * snowshoe_keygen_elligator does this for key generation.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if P is invalid or has no representative for the noise.
+ */
+extern int snowshoe_elligator_encode(const char P[64], unsigned int noise, char R[32]);
+
+/*
+ * P = Elligator(R)
+ *
+ * Decode a representative from snowshoe_elligator_encode back to the point.
+ * Unlike snowshoe_elligator, the point is not multiplied by 4.
+ *
+ * WARNING: Not constant time.  R should be public, as it is on the wire.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if one of the input parameters is invalid.
+ * It is important to check the return value to avoid active attacks.
+ */
+extern int snowshoe_elligator_decode(const char R[32], char P[64]);
+
+/*
+ * P = k_i * G, R = Elligator^-1(P)
+ *
+ * Generate a key pair with a public key that has a representative R.
+ *
+ * k: n independent random private keys from snowshoe_secret_gen, 32 bytes
+ *    apart.  These are tried in order and are not modified.
+ * noise: Random value used to pick the representative, as above.
+ *
+ * About half of the keys have a representative, so n = 8 fails with
+ * probability 1/256.  Each attempt costs one snowshoe_mul_gen.  Do not
+ * derive the keys from each other (for example k, k + 1, ...): the output
+ * would then be distinguishable from a uniform key.
+ *
+ * Returns the index i of the private key for P on success.
+ * Returns -1 if one of the input parameters is invalid or if none of the
+ * keys has a representative.  In that case P and R are not written, and the
+ * caller should try again with new keys.
+ */
+extern int snowshoe_keygen_elligator(const char *k, int n, unsigned int noise, char P[64], char R[32]);
+
 /*
  * C = kG + E
  *
@@ -190,6 +361,625 @@ extern int snowshoe_elligator_encrypt(const char k[32], const char E[128], char
  */
 extern int snowshoe_elligator_secret(const char k1[32], const char C[64], const char E[128], const char k2[32], const char V[64], char R[64]);
 
+/*
+ * P = Prepare(E, V)
+ *
+ * Prepare a long-lived Elligator point E and optional verifier point V for
+ * repeated use with snowshoe_elligator_secret_prepared.  This caches -E,
+ * and validates V and computes its endomorphism once rather than on every
+ * call.  The secret keys are not involved, so this saves only the fixed
+ * per-call work on E and V; the multiplication itself is unchanged.
+ *
+ * The V term is optional.  To disable it, pass a null ptr for V.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if one of the input parameters is invalid.
+ * It is important to check the return value to avoid active attacks.
+ */
+extern int snowshoe_elligator_prepare(const char E[128], const char V[64], char P[384]);
+
+/*
+ * R = k1 * (C - E) + k2 * V
+ *
+ * Same as snowshoe_elligator_secret, using E and V from a point prepared by
+ * snowshoe_elligator_prepare.  Only the client point C is processed per call.
+ *
+ * The V term is optional.  To disable it, pass a null ptr for k2.
+ * If V was not provided to snowshoe_elligator_prepare, k2 must be null.
+ *
+ * This function is constant-time in k1 and k2, like snowshoe_elligator_secret.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if one of the input parameters is invalid.
+ * It is important to check the return value to avoid active attacks.
+ */
+extern int snowshoe_elligator_secret_prepared(const char k1[32], const char C[64], const char P[384], const char k2[32], char R[64]);
+
+/*
+ * Key directory
+ *
+ * A key directory holds many long-lived public keys in a flat buffer that
+ * can be written to a file and memory-mapped by any number of processes.
+ * Points are validated once when the directory is built, and optionally
+ * stored with their multiplication tables for snowshoe_keydir_simul_gen
+ * (2 KB extra per key).  Lookups read the buffer in place.
+ *
+ * Layout: A 64-byte header followed by fixed-size records sorted by a
+ * 32-byte id, each with a checksum.  The records hold the internal
+ * little-endian format, so directories are not portable to big-endian
+ * machines.  Directories should only be loaded from trusted storage,
+ * since the checksums only catch accidental corruption.
+ */
+
+/*
+ * Returns the size in bytes of a directory holding n keys.
+ * Set prepared to non-zero to include the multiplication tables.
+ *
+ * Returns -1 if n is negative.
+ */
+extern long long snowshoe_keydir_size(int n, int prepared);
+
+/*
+ * Build a directory in dir, which must be snowshoe_keydir_size() bytes.
+ *
+ * ids: n unique 32-byte ids, 32 bytes apart
+ * P: n public keys, 64 bytes apart
+ *
+ * Returns 0 on success.
+ * Returns non-zero if n is negative, any point is invalid or any id is
+ * repeated.
+ */
+extern int snowshoe_keydir_build(const char *ids, const char *P, int n, int prepared, char *dir);
+
+/*
+ * Check a directory of the given size, as read from disk.
+ *
+ * The header and the checksum of every record are verified here, so that
+ * lookups do not need to.  This reads the whole directory once.
+ *
+ * Returns 0 if it can be used with the functions below.
+ */
+extern int snowshoe_keydir_open(const char *dir, long long size);
+
+/*
+ * Find the entry for id in the directory, by binary search.
+ * The directory must come from snowshoe_keydir_build, or from storage and
+ * checked with snowshoe_keydir_open.
+ *
+ * The 64-byte public key is at offset 32 in the returned entry.
+ *
+ * Returns a pointer to the entry, or null if it is not found.
+ */
+extern const char *snowshoe_keydir_find(const char *dir, const char id[32]);
+
+/*
+ * R = 4aG + 4bQ
+ *
+ * Same as snowshoe_simul_gen, where Q is an entry from snowshoe_keydir_find.
+ * The point is not validated again, and the tables are used if present.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if one of the input parameters is invalid.
+ */
+extern int snowshoe_keydir_simul_gen(const char a[32], const char b[32], const char *entry, char R[64]);
+
+/*
+ * Multi-scalar multiplication
+ *
+ * Computes R = 4 * sum(k_i * P_i) for any number of terms, streamed in
+ * chunks of any size (for example from a memory-mapped file).  The state
+ * is a fixed snowshoe_msm_size() bytes (about 1.7 MB) regardless of the
+ * number of terms, and the cost is about 26 point additions per term.
+ *
+ * To use multiple threads, give each thread its own state and a share of
+ * the chunks, then combine the states with snowshoe_msm_merge() before
+ * calling snowshoe_msm_finish().  The state is in native byte order.
+ *
+ * WARNING: Not constant time.  Only use this for public scalars.
+ */
+
+/*
+ * Returns the size in bytes of the state.
+ */
+extern int snowshoe_msm_size();
+
+/*
+ * Set the state to an empty sum.
+ */
+extern void snowshoe_msm_init(char *state);
+
+/*
+ * Add n terms to the sum.
+ *
+ * terms: n records of 96 bytes, each a 32-byte scalar followed by a
+ * 64-byte point.  Any 256-bit scalar is accepted, including zero.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if any point is invalid, and the state is unchanged.
+ */
+extern int snowshoe_msm_update(char *state, const char *terms, int n);
+
+/*
+ * Add the sum in other to the sum in state.
+ */
+extern void snowshoe_msm_merge(char *state, const char *other);
+
+/*
+ * R = 4 * sum(k_i * P_i)
+ *
+ * The state is unchanged, so more terms may be added afterwards.
+ */
+extern void snowshoe_msm_finish(const char *state, char R[64]);
+
+/*
+ * Schnorr signature half-aggregation
+ *
+ * A signature is (R, s) with R = 4rG and s = a*t + r (mod q), where a is
+ * the secret key of the signer, A = aG, and t = H(R, A, m) mod q.  It is
+ * verified by checking R = 4sG - 4tA with snowshoe_simul_gen().
+ *
+ * n signatures (R_i, s_i) are aggregated to (R_1..R_n, S) by adding the
+ * s_i with coefficients: S = sum(z_i * s_i) (mod q).  This saves 32 of
+ * the 96 bytes per signature, and the aggregate is checked with a single
+ * multi-scalar multiplication.  Snowshoe does not provide a hash function,
+ * so the caller derives the coefficients from a hash of every R_i, A_i and
+ * m_i, for example z_i = H(i, R_1, A_1, m_1, ..., R_n, A_n, m_n) mod q, and
+ * both sides must derive them the same way.
+ *
+ * Like batch verification, the aggregate check is multiplied by 4, so a
+ * signature whose R has a small-order component may pass here even though
+ * it fails on its own.
+ *
+ * Arrays hold n values of the usual size, side by side: z, s and t hold
+ * 32-byte scalars, A and R hold 64-byte points.
+ */
+
+/*
+ * S = sum(z_i * s_i) (mod q)
+ */
+extern void snowshoe_sig_aggregate(const char *z, const char *s, int n, char S[32]);
+
+/*
+ * Verify 4 * sum(z_i * R_i) = 16 * S * G - 16 * sum(z_i * t_i * A_i)
+ *
+ * WARNING: Not constant time.  The inputs should be public knowledge.
+ *
+ * Below 128 signatures the terms are summed two at a time, which costs about
+ * as much per signature as verifying each one with snowshoe_simul_gen().
+ * From 128 signatures on, a multi-scalar multiplication is used, which
+ * needs a temporary allocation of snowshoe_msm_size() bytes but gets
+ * cheaper per signature as n grows.
+ *
+ * Returns 0 if the aggregate signature is valid.
+ * Returns non-zero if it is invalid, S is not less than q, any point is
+ * invalid, or memory could not be allocated.
+ */
+extern int snowshoe_sig_verify_aggregate(const char *z, const char *t, const char *A, const char *R, int n, const char S[32]);
+
+/*
+ * Multi-signer Schnorr signatures (MuSig2)
+ *
+ * n signers with keys a_i, A_i = a_i * G produce one signature (R, S) that
+ * verifies like a single signature under an aggregate key X, so the cost
+ * of verification does not depend on n.  As above, the caller derives the
+ * hash values, and every signer must derive them the same way:
+ *
+ * 	c_i = H(A_1, ..., A_n, A_i) (mod q), the key coefficients
+ * 	X = sum(c_i * A_i) with snowshoe_musig_key()
+ *
+ * Round 1: Each signer picks two nonces r_i = (r_i1, r_i2) with
+ * snowshoe_secret_gen() and publishes N_i = (4 * r_i1 * G, 4 * r_i2 * G)
+ * from snowshoe_musig_nonce().  The nonces must never be used twice.
+ *
+ * Round 2: Each signer sums the N_i with snowshoe_musig_nonce_agg() and:
+ *
+ * 	b = H(X, N, m) (mod q)
+ * 	R = N_1 + b * N_2 with snowshoe_musig_nonce_final()
+ * 	t = H(R, X, m) (mod q)
+ * 	s_i = c_i * t * a_i + r_i1 + b * r_i2 (mod q) with snowshoe_musig_sign()
+ *
+ * The s_i are summed with snowshoe_musig_combine() to produce S, and the
+ * signature (R, S) is verified the usual way: R = snowshoe_simul_gen(S, t, -X).
+ * A bad s_i can be traced to its signer with snowshoe_musig_verify_partial().
+ */
+
+/*
+ * X = sum(c_i * A_i)
+ *
+ * c holds n 32-byte coefficients and A holds n 64-byte public keys.
+ *
+ * WARNING: Not constant time.  The inputs should be public knowledge.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if n < 1, any coefficient or point is invalid, or the
+ * sum is the identity.
+ */
+extern int snowshoe_musig_key(const char *c, const char *A, int n, char X[64]);
+
+/*
+ * N = (4 * r1 * G, 4 * r2 * G) for the nonce pair r = (r1, r2)
+ *
+ * Returns 0 on success.
+ * Returns non-zero if either nonce is invalid.
+ */
+extern int snowshoe_musig_nonce(const char r[64], char N[128]);
+
+/*
+ * N = sum(N_i), with N holding n 128-byte nonce commitments
+ *
+ * WARNING: Not constant time.  The inputs should be public knowledge.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if n < 1 or any point is invalid.
+ */
+extern int snowshoe_musig_nonce_agg(const char *N, int n, char NA[128]);
+
+/*
+ * R = N_1 + b * N_2
+ *
+ * Also used on a single signer's N_i for snowshoe_musig_verify_partial().
+ *
+ * WARNING: Not constant time.  The inputs should be public knowledge.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if b or either point is invalid.
+ */
+extern int snowshoe_musig_nonce_final(const char NA[128], const char b[32], char R[64]);
+
+/*
+ * s = c * t * a + r1 + b * r2 (mod q)
+ *
+ * Inputs are the secret key a, its coefficient c, the nonce pair r from
+ * round 1, and the hash values b and t.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if any input is not less than q.
+ */
+extern int snowshoe_musig_sign(const char a[32], const char c[32], const char r[64], const char b[32], const char t[32], char s[32]);
+
+/*
+ * Verify 4 * s * G = N_1 + b * N_2 + 4 * c * t * A for one signer
+ *
+ * WARNING: Not constant time.  The inputs should be public knowledge.
+ *
+ * Returns 0 if the partial signature is valid.
+ * Returns non-zero if it is invalid or any input is invalid.
+ */
+extern int snowshoe_musig_verify_partial(const char A[64], const char c[32], const char N[128], const char b[32], const char t[32], const char s[32]);
+
+/*
+ * S = sum(s_i) (mod q)
+ */
+extern void snowshoe_musig_combine(const char *s, int n, char S[32]);
+
+/*
+ * Commitments
+ *
+ * C = k * G + r * H hides the value k behind the blinding factor r, and
+ * commitments add: C(k1, r1) + C(k2, r2) = C(k1 + k2, r1 + r2).  G is the
+ * generator point and H is a second base point that nobody knows the
+ * discrete logarithm of:
+ *
+ * 	H = snowshoe_hash_to_curve(h), where h is the first 64 bytes of the
+ * 	fractional part of pi (243F6A8885A308D3...) in hex
+ *
+ * Both points have order q, so unlike the other functions here the result
+ * is not multiplied by 4.
+ */
+
+/*
+ * C = k * G + r * H
+ *
+ * The value k may be zero.  The blinding factor r should be produced by
+ * snowshoe_secret_gen() and never reused.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if k is not less than q or r is zero or not less than q.
+ */
+extern int snowshoe_commit(const char k[32], const char r[32], char C[64]);
+
+/*
+ * C[i] = k[i] * G + r[i] * H
+ *
+ * Same as snowshoe_commit() for n value/blinding pairs.  Conversion to
+ * affine coordinates shares one field inversion across each group of
+ * commitments, so this is faster than committing one at a time.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if any scalar is invalid, in which case C is untouched.
+ */
+extern int snowshoe_commit_batch(const char *k, const char *r, int n, char *C);
+
+/*
+ * Thread pool
+ *
+ * The pool runs the batch functions below across worker threads, which
+ * balance the load by stealing chunks of work from each other.  Any
+ * number of threads may submit batches to the same pool at once, and
+ * each call returns when its batch is complete.
+ *
+ * Do not call the batch functions from inside a worker thread.
+ */
+
+typedef struct snowshoe_pool snowshoe_pool;
+
+// Pin worker i to CPU i (Linux only)
+#define SNOWSHOE_POOL_PIN 1
+
+/*
+ * Start a pool of worker threads.  Pass 0 threads to use one per CPU.
+ *
+ * Returns a pool to pass to the other functions, or null on failure.
+ */
+extern snowshoe_pool *snowshoe_pool_create(int threads, int flags);
+
+/*
+ * Stop the workers and free the pool.  No batches may be in progress.
+ */
+extern void snowshoe_pool_free(snowshoe_pool *pool);
+
+/*
+ * Returns the number of worker threads.
+ */
+extern int snowshoe_pool_threads(snowshoe_pool *pool);
+
+/*
+ * Batch versions of the functions above, for n inputs each.
+ *
+ * The arrays are packed with the same sizes as the single-shot inputs and
+ * outputs.  For example, snowshoe_pool_mul reads k[32 * i] and P[64 * i]
+ * and writes R[64 * i].
+ *
+ * Returns 0 on success.
+ * Returns non-zero if any input was invalid, and the outputs for invalid
+ * inputs are set to zero.  Also returns non-zero if n is negative or if
+ * memory runs out, in which case the outputs are undefined.
+ */
+extern int snowshoe_pool_mul_gen(snowshoe_pool *pool, const char *k, int n, char *R, char mul4);
+extern int snowshoe_pool_mul(snowshoe_pool *pool, const char *k, const char *P, int n, char *R);
+extern int snowshoe_pool_simul_gen(snowshoe_pool *pool, const char *a, const char *b, const char *Q, int n, char *R);
+extern int snowshoe_pool_elligator(snowshoe_pool *pool, const char *keys, int n, char *E);
+
+/*
+ * R = 4 * sum(k_i * P_i)
+ *
+ * Same as snowshoe_msm_update followed by snowshoe_msm_finish, with each
+ * worker filling its own buckets.  Needs snowshoe_msm_size() bytes of
+ * memory per worker.
+ *
+ * Returns 0 on success.
+ * Returns non-zero if any point is invalid, n is negative or memory runs
+ * out, and R is not written.
+ */
+extern int snowshoe_pool_msm(snowshoe_pool *pool, const char *terms, long long n, char R[64]);
+
+/*
+ * Asynchronous rings
+ *
+ * For event loops that cannot block for a point multiplication.  Queue
+ * operations with snowshoe_ring_submit(), which returns immediately, and
+ * worker threads run them in batches.  When operations finish, the file
+ * descriptor from snowshoe_ring_fd() becomes readable (Linux eventfd), and
+ * snowshoe_ring_complete() returns their tags and results.
+ *
+ * The buffers an operation points to must stay valid until its completion
+ * has been returned.  At most the ring size of operations may be in
+ * flight, counting those completed but not yet returned.
+ */
+
+typedef struct snowshoe_ring snowshoe_ring;
+
+// Operations, with the same inputs and outputs as the functions above
+#define SNOWSHOE_OP_MUL_GEN 1 /* R = snowshoe_mul_gen(a, mul4) */
+#define SNOWSHOE_OP_MUL 2 /* R = snowshoe_mul(a, P) */
+#define SNOWSHOE_OP_SIMUL_GEN 3 /* R = snowshoe_simul_gen(a, b, Q) */
+#define SNOWSHOE_OP_SIMUL 4 /* R = snowshoe_simul(a, P, b, Q) */
+#define SNOWSHOE_OP_ELLIGATOR 5 /* R[128] = snowshoe_elligator(a) */
+
+typedef struct snowshoe_op {
+	unsigned long long tag; /* Returned with the completion */
+	int op;
+	char mul4;
+	const char *a, *b, *P, *Q;
+	char *R;
+} snowshoe_op;
+
+typedef struct snowshoe_completion {
+	unsigned long long tag;
+	int result; /* Return value of the function */
+} snowshoe_completion;
+
+/*
+ * Create rings with room for the given number of operations (rounded up
+ * to a power of two), and worker threads to run them.  Pass 0 threads to
+ * use one per CPU.
+ *
+ * Returns the rings, or null on failure.
+ */
+extern snowshoe_ring *snowshoe_ring_create(int entries, int threads);
+
+/*
+ * Stop the workers and free the rings.  Queued operations are dropped.
+ */
+extern void snowshoe_ring_free(snowshoe_ring *ring);
+
+/*
+ * Returns a file descriptor to poll for completions, or -1 if eventfd is
+ * not available on this platform.  Do not close it.
+ */
+extern int snowshoe_ring_fd(snowshoe_ring *ring);
+
+/*
+ * Queue up to n operations without blocking.
+ *
+ * Returns the number of operations queued, which is less than n if the
+ * ring is full.  Returns -1 if n is negative.
+ */
+extern int snowshoe_ring_submit(snowshoe_ring *ring, const snowshoe_op *ops, int n);
+
+/*
+ * Return up to max finished operations without blocking.
+ *
+ * Returns the number of completions written to done.
+ */
+extern int snowshoe_ring_complete(snowshoe_ring *ring, snowshoe_completion *done, int max);
+
+/*
+ * Request coalescer
+ *
+ * Drop-in versions of the single-shot functions for servers that make
+ * many concurrent calls from different threads.  Concurrent calls of the
+ * same kind are gathered into batches of up to `lanes` calls, which share
+ * the final inversion.  A call waits at most budget_usec for others to
+ * join its batch, and then for the batch to run on the thread that made
+ * the first call.
+ *
+ * Only the final inversion is shared, which is a small part of a point
+ * multiplication: a coalesced snowshoe_mul is only a few percent faster
+ * than a plain one.  Elligator gains much more, since its inversions are
+ * most of the work.  When idle each call takes up to budget_usec longer.
+ */
+
+typedef struct snowshoe_coalescer snowshoe_coalescer;
+
+/*
+ * Create a coalescer.  Pass 0 lanes for the default of 8 (at most 32).
+ *
+ * Returns the coalescer, or null if a parameter is out of range.
+ */
+extern snowshoe_coalescer *snowshoe_coalescer_create(int budget_usec, int lanes);
+
+/*
+ * Free the coalescer.  No calls may be in progress.
+ */
+extern void snowshoe_coalescer_free(snowshoe_coalescer *c);
+
+/*
+ * Same inputs, outputs and return values as snowshoe_mul_gen,
+ * snowshoe_mul, snowshoe_simul_gen and snowshoe_elligator.
+ */
+extern int snowshoe_coalesced_mul_gen(snowshoe_coalescer *c, const char k[32], char R[64], char mul4);
+extern int snowshoe_coalesced_mul(snowshoe_coalescer *c, const char k[32], const char P[64], char R[64]);
+extern int snowshoe_coalesced_simul_gen(snowshoe_coalescer *c, const char a[32], const char b[32], const char Q[64], char R[64]);
+extern int snowshoe_coalesced_elligator(snowshoe_coalescer *c, const char key[32], char E[128]);
+
+/*
+ * Operation counts
+ *
+ * In a build with CAT_SNOWSHOE_COUNT_OPS defined, the library counts the
+ * field operations, table lookups and point operations run by each thread.
+ * Take a snapshot before and after a call and subtract to get its costs.
+ *
+ * fp_* counts are in the base field Fp and fe_* counts are in Fp^2, which
+ * is what the cost comments in the source use (M, S, A, U, D, I).  Each
+ * operation counts once, without its internal steps: an fe_mul does not
+ * add to the fp counts, and an inversion, square root or chi does not add
+ * the multiplications inside it.
+ */
+
+typedef struct snowshoe_counts {
+	unsigned long long fp_mul, fp_sqr, fp_add, fp_mul_smallk;
+	unsigned long long fp_inv, fp_sqrt, fp_chi;
+	unsigned long long fe_mul, fe_sqr, fe_add, fe_mul_u, fe_mul_smallk;
+	unsigned long long fe_inv, fe_sqrt, fe_chi;
+	unsigned long long table_select, ec_add, ec_dbl;
+} snowshoe_counts;
+
+/*
+ * Copy the counts for the calling thread into counts.
+ *
+ * Returns 0 on success.
+ * Returns non-zero and zeroes counts if counting is not built in.
+ */
+extern int snowshoe_counts_snapshot(snowshoe_counts *counts);
+
+/*
+ * Runtime statistics
+ *
+ * In a build with CAT_SNOWSHOE_STATS defined, each thread keeps call and
+ * item counts and a latency histogram for the public entry points below.
+ * Collection is off until snowshoe_stats_enable(1), and while it is off
+ * each call costs one predictable branch.  Batch calls count one call and
+ * n items, so items / calls is the average batch size.
+ *
+ * On Linux with <sys/sdt.h> available, the same build has USDT probes
+ * snowshoe:op__entry(op, items) and snowshoe:op__return(op, items) at each
+ * entry point for perf and bpftrace.  They are no-ops until attached.
+ *
+ * Histogram bucket b counts calls that took at least
+ * snowshoe_stats_bucket_ns(b) and less than snowshoe_stats_bucket_ns(b + 1)
+ * nanoseconds: four buckets per power of two, so within 25%.
+ */
+
+#define SNOWSHOE_STAT_MUL_GEN 0
+#define SNOWSHOE_STAT_MUL 1
+#define SNOWSHOE_STAT_SIMUL_GEN 2
+#define SNOWSHOE_STAT_SIMUL 3
+#define SNOWSHOE_STAT_VALID 4 /* Including snowshoe_valid_soa */
+#define SNOWSHOE_STAT_ELLIGATOR 5
+#define SNOWSHOE_STAT_ELLIGATOR_BATCH 6
+#define SNOWSHOE_STAT_HASH_TO_CURVE 7
+#define SNOWSHOE_STAT_HASH_TO_CURVE_BATCH 8 /* Including the SoA version */
+#define SNOWSHOE_STAT_ELLIGATOR_ENCODE 9
+#define SNOWSHOE_STAT_ELLIGATOR_DECODE 10
+#define SNOWSHOE_STAT_KEYGEN_ELLIGATOR 11
+#define SNOWSHOE_STAT_ELLIGATOR_ENCRYPT 12
+#define SNOWSHOE_STAT_ELLIGATOR_SECRET 13
+#define SNOWSHOE_STAT_ELLIGATOR_PREPARE 14
+#define SNOWSHOE_STAT_ELLIGATOR_SECRET_PREPARED 15
+#define SNOWSHOE_STAT_KEYDIR_FIND 16
+#define SNOWSHOE_STAT_KEYDIR_SIMUL_GEN 17
+#define SNOWSHOE_STAT_MSM_UPDATE 18
+#define SNOWSHOE_STAT_MSM_FINISH 19
+#define SNOWSHOE_STAT_MUL_SHORT 20
+#define SNOWSHOE_STAT_SIMUL_SHORT 21
+#define SNOWSHOE_STAT_SIG_VERIFY_AGGREGATE 22
+#define SNOWSHOE_STAT_MUSIG_KEY 23
+#define SNOWSHOE_STAT_MUSIG_NONCE 24
+#define SNOWSHOE_STAT_MUSIG_NONCE_FINAL 25
+#define SNOWSHOE_STAT_MUSIG_VERIFY_PARTIAL 26
+#define SNOWSHOE_STAT_COMMIT 27
+#define SNOWSHOE_STAT_COMMIT_BATCH 28
+#define SNOWSHOE_STAT_COUNT 29
+
+#define SNOWSHOE_STATS_BUCKETS 128
+
+typedef struct snowshoe_stats_op {
+	unsigned long long calls, items, total_ns;
+	unsigned long long histogram[SNOWSHOE_STATS_BUCKETS];
+} snowshoe_stats_op;
+
+typedef struct snowshoe_stats {
+	snowshoe_stats_op ops[SNOWSHOE_STAT_COUNT];
+
+	/* Key directory lookups that found a valid entry or did not */
+	unsigned long long keydir_hits, keydir_misses;
+} snowshoe_stats;
+
+/*
+ * Turn collection on (non-zero) or off for all threads.
+ */
+extern void snowshoe_stats_enable(int enabled);
+
+/*
+ * Merge the statistics from all threads, including threads that have
+ * exited, into stats.  Subtract two snapshots to cover an interval.
+ *
+ * Returns 0 on success.
+ * Returns non-zero and zeroes stats if statistics are not built in.
+ */
+extern int snowshoe_stats_snapshot(snowshoe_stats *stats);
+
+/*
+ * Name of a SNOWSHOE_STAT_* operation, e.g. "mul_gen", or null.
+ */
+extern const char *snowshoe_stats_name(int op);
+
+/*
+ * Lower bound in nanoseconds of a histogram bucket.
+ */
+extern unsigned long long snowshoe_stats_bucket_ns(int bucket);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,498 @@
+/*
+	Copyright (c) 2013-2014 Christopher A. Taylor.  All rights reserved.
+
+	Redistribution and use in source and binary forms, with or without
+	modification, are permitted provided that the following conditions are met:
+
+	* Redistributions of source code must retain the above copyright notice,
+	  this list of conditions and the following disclaimer.
+	* Redistributions in binary form must reproduce the above copyright notice,
+	  this list of conditions and the following disclaimer in the documentation
+	  and/or other materials provided with the distribution.
+	* Neither the name of Snowshoe nor the names of its contributors may be
+	  used to endorse or promote products derived from this software without
+	  specific prior written permission.
+
+	THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+	AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+	IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+	ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+	LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+	CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+	SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+	INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+	CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+	ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+	POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef CAT_SNOWSHOE_CPP_HPP
+#define CAT_SNOWSHOE_CPP_HPP
+
+/*
+ * C++20 interface
+ *
+ * Header-only wrappers around snowshoe.h with typed values, spans for the
+ * batch functions, and coroutine awaitables for the asynchronous rings.
+ * The value types have the same layout as the byte arrays in snowshoe.h,
+ * so spans of them are passed to the C functions without copies.
+ *
+ * Functions return false or an empty std::optional wherever the C
+ * function would return non-zero.
+ */
+
+#include "snowshoe.h"
+
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace snowshoe {
+
+
+//// Value types
+
+// Public 256-bit scalar, little-endian
+struct Scalar {
+	char bytes[32];
+};
+
+// Affine point (x, y)
+struct Point {
+	char bytes[64];
+};
+
+// Elligator key pair from snowshoe_elligator
+struct ElligatorPoint {
+	char bytes[128];
+};
+
+// Input hash for snowshoe_hash_to_curve
+struct Hash {
+	char bytes[64];
+};
+
+// Multi-scalar multiplication term, as read by snowshoe_msm_update
+struct Term {
+	Scalar k;
+	Point P;
+};
+
+static_assert(sizeof(Scalar) == 32 && sizeof(Point) == 64 && sizeof(ElligatorPoint) == 128, "Packed");
+static_assert(sizeof(Hash) == 64 && sizeof(Term) == 96, "Packed");
+
+// Clear memory in a way the compiler will not optimize out
+inline void secure_erase(void *data, std::size_t bytes) {
+	volatile char *p = static_cast<volatile char *>(data);
+
+	while (bytes--) {
+		*p++ = 0;
+	}
+}
+
+// Packed bytes of a span, without dereferencing data() when it is empty
+template <typename T>
+inline const char *bytes_of(std::span<const T> s) {
+	return reinterpret_cast<const char *>(s.data());
+}
+
+template <typename T>
+inline char *bytes_of(std::span<T> s) {
+	return reinterpret_cast<char *>(s.data());
+}
+
+/*
+ * Secret scalar
+ *
+ * Move-only, and erased when destroyed or moved from.
+ */
+class SecretScalar {
+public:
+	SecretScalar() = default;
+
+	// Mask 32 random bytes into a valid secret key
+	explicit SecretScalar(std::span<const char, 32> random) {
+		std::memcpy(bytes_, random.data(), 32);
+		snowshoe_secret_gen(bytes_);
+	}
+
+	SecretScalar(const SecretScalar &) = delete;
+	SecretScalar &operator=(const SecretScalar &) = delete;
+
+	SecretScalar(SecretScalar &&other) noexcept {
+		std::memcpy(bytes_, other.bytes_, 32);
+		secure_erase(other.bytes_, 32);
+	}
+
+	SecretScalar &operator=(SecretScalar &&other) noexcept {
+		if (this != &other) {
+			std::memcpy(bytes_, other.bytes_, 32);
+			secure_erase(other.bytes_, 32);
+		}
+		return *this;
+	}
+
+	~SecretScalar() {
+		secure_erase(bytes_, 32);
+	}
+
+	const char *data() const {
+		return bytes_;
+	}
+
+private:
+	char bytes_[32] = {};
+};
+
+static_assert(sizeof(SecretScalar) == 32, "Packed");
+
+/*
+ * Point with precomputed multiplication tables for simul_gen
+ *
+ * About 2 KB, worth it for long-lived keys used in many verifications.
+ */
+class PreparedPoint {
+public:
+	static std::optional<PreparedPoint> prepare(const Point &P) {
+		PreparedPoint r;
+		const char id[32] = {};
+
+		r.dir_.resize((std::size_t)snowshoe_keydir_size(1, 1));
+		if (snowshoe_keydir_build(id, P.bytes, 1, 1, r.dir_.data())) {
+			return std::nullopt;
+		}
+
+		r.offset_ = (std::size_t)(snowshoe_keydir_find(r.dir_.data(), id) - r.dir_.data());
+		return r;
+	}
+
+	// Entry for snowshoe_keydir_simul_gen
+	const char *entry() const {
+		return dir_.data() + offset_;
+	}
+
+private:
+	PreparedPoint() = default;
+
+	// Offset rather than a pointer, so that copies point into their own buffer
+	std::vector<char> dir_;
+	std::size_t offset_ = 0;
+};
+
+
+//// Single operations
+
+// R = [4]kG
+inline std::optional<Point> mul_gen(const SecretScalar &k, bool mul4 = false) {
+	Point R;
+	if (snowshoe_mul_gen(k.data(), R.bytes, mul4 ? 1 : 0)) {
+		return std::nullopt;
+	}
+	return R;
+}
+
+// R = 4kP
+inline std::optional<Point> mul(const SecretScalar &k, const Point &P) {
+	Point R;
+	if (snowshoe_mul(k.data(), P.bytes, R.bytes)) {
+		return std::nullopt;
+	}
+	return R;
+}
+
+// R = 4aG + 4bQ
+inline std::optional<Point> simul_gen(const Scalar &a, const Scalar &b, const Point &Q) {
+	Point R;
+	if (snowshoe_simul_gen(a.bytes, b.bytes, Q.bytes, R.bytes)) {
+		return std::nullopt;
+	}
+	return R;
+}
+
+// R = 4aG + 4bQ
+inline std::optional<Point> simul_gen(const Scalar &a, const Scalar &b, const PreparedPoint &Q) {
+	Point R;
+	if (snowshoe_keydir_simul_gen(a.bytes, b.bytes, Q.entry(), R.bytes)) {
+		return std::nullopt;
+	}
+	return R;
+}
+
+// R = 4aP + 4bQ
+inline std::optional<Point> simul(const SecretScalar &a, const Point &P, const SecretScalar &b, const Point &Q) {
+	Point R;
+	if (snowshoe_simul(a.data(), P.bytes, b.data(), Q.bytes, R.bytes)) {
+		return std::nullopt;
+	}
+	return R;
+}
+
+// E = Elligator(key)
+inline std::optional<ElligatorPoint> elligator(const Scalar &key) {
+	ElligatorPoint E;
+	if (snowshoe_elligator(key.bytes, E.bytes)) {
+		return std::nullopt;
+	}
+	return E;
+}
+
+// R = HashToCurve(h)
+inline std::optional<Point> hash_to_curve(const Hash &h) {
+	Point R;
+	if (snowshoe_hash_to_curve(h.bytes, R.bytes)) {
+		return std::nullopt;
+	}
+	return R;
+}
+
+
+//// Batches on the calling thread
+
+// E[i] = Elligator(keys[i])
+inline bool elligator(std::span<const Scalar> keys, std::span<ElligatorPoint> E) {
+	return keys.size() == E.size() &&
+		0 == snowshoe_elligator_batch(bytes_of(keys), (int)keys.size(), bytes_of(E));
+}
+
+// R[i] = HashToCurve(h[i])
+inline bool hash_to_curve(std::span<const Hash> h, std::span<Point> R) {
+	return h.size() == R.size() &&
+		0 == snowshoe_hash_to_curve_batch(bytes_of(h), (int)h.size(), bytes_of(R));
+}
+
+// R = 4 * sum(k_i * P_i)
+inline std::optional<Point> msm(std::span<const Term> terms) {
+	static const std::size_t CHUNK = 1 << 20;
+
+	std::vector<char> state((std::size_t)snowshoe_msm_size());
+	snowshoe_msm_init(state.data());
+
+	for (std::size_t ii = 0; ii < terms.size(); ii += CHUNK) {
+		const std::size_t n = terms.size() - ii < CHUNK ? terms.size() - ii : CHUNK;
+
+		if (snowshoe_msm_update(state.data(), terms[ii].k.bytes, (int)n)) {
+			return std::nullopt;
+		}
+	}
+
+	Point R;
+	snowshoe_msm_finish(state.data(), R.bytes);
+	return R;
+}
+
+
+//// Batches on a thread pool
+
+class Pool {
+public:
+	explicit Pool(int threads = 0, int flags = 0)
+		: pool_(snowshoe_pool_create(threads, flags)) {
+	}
+
+	Pool(const Pool &) = delete;
+	Pool &operator=(const Pool &) = delete;
+
+	~Pool() {
+		snowshoe_pool_free(pool_);
+	}
+
+	// False if the threads could not be started
+	explicit operator bool() const {
+		return pool_ != nullptr;
+	}
+
+	int threads() const {
+		return snowshoe_pool_threads(pool_);
+	}
+
+	bool mul_gen(std::span<const SecretScalar> k, std::span<Point> R, bool mul4 = false) {
+		return k.size() == R.size() &&
+			0 == snowshoe_pool_mul_gen(pool_, bytes_of(k), (int)k.size(), bytes_of(R), mul4 ? 1 : 0);
+	}
+
+	bool mul(std::span<const SecretScalar> k, std::span<const Point> P, std::span<Point> R) {
+		return k.size() == R.size() && P.size() == R.size() &&
+			0 == snowshoe_pool_mul(pool_, bytes_of(k), bytes_of(P), (int)k.size(), bytes_of(R));
+	}
+
+	bool simul_gen(std::span<const Scalar> a, std::span<const Scalar> b, std::span<const Point> Q, std::span<Point> R) {
+		return a.size() == R.size() && b.size() == R.size() && Q.size() == R.size() &&
+			0 == snowshoe_pool_simul_gen(pool_, bytes_of(a), bytes_of(b), bytes_of(Q), (int)a.size(), bytes_of(R));
+	}
+
+	bool elligator(std::span<const Scalar> keys, std::span<ElligatorPoint> E) {
+		return keys.size() == E.size() &&
+			0 == snowshoe_pool_elligator(pool_, bytes_of(keys), (int)keys.size(), bytes_of(E));
+	}
+
+	std::optional<Point> msm(std::span<const Term> terms) {
+		Point R;
+		if (snowshoe_pool_msm(pool_, bytes_of(terms), (long long)terms.size(), R.bytes)) {
+			return std::nullopt;
+		}
+		return R;
+	}
+
+private:
+	snowshoe_pool *pool_;
+};
+
+
+//// Coroutines on the asynchronous rings
+
+/*
+ * Operations on a Ring are awaitables that resume the coroutine from
+ * dispatch(), which an event loop calls when fd() is readable:
+ *
+ *	Point R;
+ *	if (co_await ring.mul(k, P, R)) { ... }
+ *
+ * The inputs must stay alive until the co_await completes, which holds
+ * for arguments passed directly as above.  Submit and dispatch from one
+ * thread, normally the event loop.
+ */
+class Ring {
+public:
+	class Operation {
+	public:
+		bool await_ready() const noexcept {
+			return false;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) {
+			handle_ = handle;
+			op_.tag = (unsigned long long)(std::uintptr_t)this;
+			ring_.submit(this);
+		}
+
+		// True if the operation succeeded
+		bool await_resume() const noexcept {
+			return result_ == 0;
+		}
+
+	private:
+		friend class Ring;
+
+		Operation(Ring &ring, int op)
+			: ring_(ring), result_(-1) {
+			std::memset(&op_, 0, sizeof(op_));
+			op_.op = op;
+		}
+
+		Ring &ring_;
+		snowshoe_op op_;
+		std::coroutine_handle<> handle_;
+		int result_;
+	};
+
+	Ring(int entries, int threads = 0)
+		: ring_(snowshoe_ring_create(entries, threads)) {
+	}
+
+	Ring(const Ring &) = delete;
+	Ring &operator=(const Ring &) = delete;
+
+	~Ring() {
+		snowshoe_ring_free(ring_);
+	}
+
+	// False if the rings could not be created
+	explicit operator bool() const {
+		return ring_ != nullptr;
+	}
+
+	// File descriptor to poll, or -1 to call dispatch() periodically
+	int fd() const {
+		return snowshoe_ring_fd(ring_);
+	}
+
+	// Resume coroutines whose operations finished.  Returns how many
+	int dispatch() {
+		int total = 0;
+
+		for (;;) {
+			snowshoe_completion done[64];
+			const int n = snowshoe_ring_complete(ring_, done, 64);
+
+			// Submit operations that did not fit before
+			while (!waiting_.empty() && 1 == snowshoe_ring_submit(ring_, &waiting_.front()->op_, 1)) {
+				waiting_.pop_front();
+			}
+
+			if (n <= 0) {
+				return total;
+			}
+
+			for (int ii = 0; ii < n; ++ii) {
+				Operation *op = (Operation *)(std::uintptr_t)done[ii].tag;
+				op->result_ = done[ii].result;
+				op->handle_.resume();
+			}
+
+			total += n;
+		}
+	}
+
+	Operation mul_gen(const SecretScalar &k, Point &R, bool mul4 = false) {
+		Operation op(*this, SNOWSHOE_OP_MUL_GEN);
+		op.op_.a = k.data();
+		op.op_.R = R.bytes;
+		op.op_.mul4 = mul4 ? 1 : 0;
+		return op;
+	}
+
+	Operation mul(const SecretScalar &k, const Point &P, Point &R) {
+		Operation op(*this, SNOWSHOE_OP_MUL);
+		op.op_.a = k.data();
+		op.op_.P = P.bytes;
+		op.op_.R = R.bytes;
+		return op;
+	}
+
+	Operation simul_gen(const Scalar &a, const Scalar &b, const Point &Q, Point &R) {
+		Operation op(*this, SNOWSHOE_OP_SIMUL_GEN);
+		op.op_.a = a.bytes;
+		op.op_.b = b.bytes;
+		op.op_.Q = Q.bytes;
+		op.op_.R = R.bytes;
+		return op;
+	}
+
+	Operation simul(const SecretScalar &a, const Point &P, const SecretScalar &b, const Point &Q, Point &R) {
+		Operation op(*this, SNOWSHOE_OP_SIMUL);
+		op.op_.a = a.data();
+		op.op_.P = P.bytes;
+		op.op_.b = b.data();
+		op.op_.Q = Q.bytes;
+		op.op_.R = R.bytes;
+		return op;
+	}
+
+	Operation elligator(const Scalar &key, ElligatorPoint &E) {
+		Operation op(*this, SNOWSHOE_OP_ELLIGATOR);
+		op.op_.a = key.bytes;
+		op.op_.R = E.bytes;
+		return op;
+	}
+
+private:
+	void submit(Operation *op) {
+		// Keep operations in order once any are waiting for room
+		if (!waiting_.empty() || 1 != snowshoe_ring_submit(ring_, &op->op_, 1)) {
+			waiting_.push_back(op);
+		}
+	}
+
+	snowshoe_ring *ring_;
+	std::deque<Operation *> waiting_;
+};
+
+
+} // namespace snowshoe
+
+#endif // CAT_SNOWSHOE_CPP_HPP
@@ -3,6 +3,23 @@
 
 #include "fe.hpp"
 
+/*
+ * Explicit SIMD table selection.
+ *
+ * The constant-time table scans are a large part of the point multiplication
+ * time.  With AVX-512 a whole affine point fits in one register and can be
+ * selected with a masked move, and with AVX2 it takes two blends.
+ * These are enabled by the compiler target flags (e.g. -mavx2, -mavx512f).
+ */
+
+#if defined(__AVX512F__) && defined(CAT_WORD_64)
+# define CAT_SNOWSHOE_AVX512 /* This flag is used by the rest of the code */
+# include <immintrin.h>
+#elif defined(__AVX2__) && defined(CAT_WORD_64)
+# define CAT_SNOWSHOE_AVX2 /* This flag is used by the rest of the code */
+# include <immintrin.h>
+#endif
+
 namespace cat {
 
 
@@ -41,6 +58,14 @@ struct ecpt_z1 {
 	ufe x, y, t;
 };
 
+/*
+ * A long-lived base point prepared for ec_simul_prep:
+ * P and its endomorphism Pe, both expanded with Z = 1.
+ */
+struct ecpt_prep {
+	ecpt p, pe;
+};
+
 /*
  * So about vector extensions.
  *
@@ -45,6 +45,10 @@
 #include "ecmul.inc"
 #include "snowshoe.h"
 
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
 #ifndef CAT_ENDIAN_LITTLE
 
 #include "SecureErase.hpp"
@@ -76,8 +80,85 @@ static CAT_INLINE void ec_save_k(const u64 k[4], char k_chars[32]) {
 	k_raw[3] = getLE(k[3]);
 }
 
+static CAT_INLINE void ec_load_s(const char s_chars[16], u64 s[2]) {
+	const u64 *s_raw = reinterpret_cast<const u64 *>( s_chars );
+
+	s[0] = getLE(s_raw[0]);
+	s[1] = getLE(s_raw[1]);
+}
+
 #endif // CAT_ENDIAN_LITTLE
 
+#include "stats.inc"
+
+/*
+ * Prepared Elligator verifier for snowshoe_elligator_secret_prepared
+ *
+ * ne: -E with the full T coordinate
+ * v: Prepared V, or all zero if V was not provided
+ */
+struct ec_verifier {
+	ecpt ne;
+	ecpt_prep v;
+};
+
+/*
+ * Key directory layout
+ *
+ * The directory is a 64-byte header followed by records sorted by id.
+ * Each record is 128 bytes, plus the two GLV tables for
+ * ec_simul_gen_prep_affine when prepared.  All sizes are multiples of 64
+ * so that records stay aligned to cache lines in a mapped file.
+ */
+
+static const u64 KEYDIR_MAGIC = 0x5249444B574F4E53ULL; // "SNOWKDIR"
+static const u32 KEYDIR_VERSION = 1;
+static const u32 KEYDIR_PREPARED = 1;
+
+struct keydir_header {
+	u64 magic;
+	u32 version, flags;
+	u64 count, record_bytes;
+	u64 checksum;
+	u64 reserved[3];
+};
+
+struct keydir_record {
+	char id[32];
+	ecpt_affine p;
+	u64 checksum;
+	u64 flags;
+	u64 reserved[2];
+	// Followed by ecpt tables[2][8] if prepared
+};
+
+// Checksum to catch corrupted files (not a security measure)
+static u64 keydir_checksum(const u64 *words, int count, u64 h) {
+	for (int ii = 0; ii < count; ++ii) {
+		h ^= words[ii];
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 32;
+	}
+
+	return h;
+}
+
+static u64 keydir_record_checksum(const keydir_record *r) {
+	u64 h = keydir_checksum((const u64 *)r, (32 + 64) / 8, 0x9E3779B97F4A7C15ULL);
+
+	h = keydir_checksum(&r->flags, 1, h);
+
+	if (r->flags & KEYDIR_PREPARED) {
+		h = keydir_checksum((const u64 *)(r + 1), sizeof(ecpt) * 16 / 8, h);
+	}
+
+	return h;
+}
+
+static int keydir_compare(const void *a, const void *b) {
+	return memcmp(a, b, 32);
+}
+
 // Check if k == 0 in constant-time
 static bool is_zero(const u64 k[4]) {
 	u64 zero = k[0] | k[1] | k[2] | k[3];
@@ -288,6 +369,18 @@ int _snowshoe_init(int expected_version) {
 		return -1;
 	}
 
+	if (sizeof(snowshoe_counts) != sizeof(u64) * COUNT_MAX) {
+		return -1;
+	}
+
+	if (sizeof(keydir_header) != 64 || sizeof(keydir_record) != 128) {
+		return -1;
+	}
+
+	if (sizeof(ec_verifier) != 384) {
+		return -1;
+	}
+
 	if (!self_test()) {
 		return -1;
 	}
@@ -393,6 +486,8 @@ void snowshoe_neg(const char P[64], char R[64]) {
 }
 
 int snowshoe_valid(const char P[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_VALID, 1);
+
 #ifndef CAT_ENDIAN_LITTLE
 	// Load point
 	ecpt_affine p1;
@@ -413,7 +508,65 @@ int snowshoe_valid(const char P[64]) {
 	return 0;
 }
 
+// Zero unused columns of the last SoA block
+static void soa_zero_tail(u8 *b, int n) {
+	ecpt_affine a;
+	fe_zero(a.x);
+	fe_zero(a.y);
+
+	for (int ii = n; ii % EC_SOA_WIDTH; ++ii) {
+		ec_save_xy_soa(a, b + (ii / EC_SOA_WIDTH) * 512, ii % EC_SOA_WIDTH);
+	}
+}
+
+// Convert n points from ec_save_xy format to SoA blocks
+void snowshoe_xy_to_soa(const char *P, int n, char *B) {
+	const u8 *p = (const u8 *)P;
+	u8 *b = (u8 *)B;
+
+	for (int ii = 0; ii < n; ++ii) {
+		ecpt_affine a;
+		ec_load_xy(p + ii * 64, a);
+		ec_save_xy_soa(a, b + (ii / EC_SOA_WIDTH) * 512, ii % EC_SOA_WIDTH);
+	}
+
+	soa_zero_tail(b, n);
+}
+
+// Convert n points from SoA blocks to ec_save_xy format
+void snowshoe_soa_to_xy(const char *B, int n, char *P) {
+	const u8 *b = (const u8 *)B;
+	u8 *p = (u8 *)P;
+
+	for (int ii = 0; ii < n; ++ii) {
+		ecpt_affine a;
+		ec_load_xy_soa(b + (ii / EC_SOA_WIDTH) * 512, ii % EC_SOA_WIDTH, a);
+		ec_save_xy(a, p + ii * 64);
+	}
+}
+
+// Validate n points in SoA blocks
+int snowshoe_valid_soa(const char *B, int n) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_VALID, n);
+
+	const u8 *b = (const u8 *)B;
+
+	for (int ii = 0; ii < n; ++ii) {
+		ecpt_affine a;
+		ec_load_xy_soa(b + (ii / EC_SOA_WIDTH) * 512, ii % EC_SOA_WIDTH, a);
+
+		// If point is invalid,
+		if (!ec_valid_vartime(a)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 int snowshoe_mul_gen(const char k_raw[32], char R[64], char mul4) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MUL_GEN, 1);
+
 #ifndef CAT_ENDIAN_LITTLE
 	u64 k[4];
 	ec_load_k(k_raw, k);
@@ -462,6 +615,8 @@ int snowshoe_mul_gen(const char k_raw[32], char R[64], char mul4) {
 }
 
 int snowshoe_mul(const char k_raw[32], const char P[64], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MUL, 1);
+
 #ifndef CAT_ENDIAN_LITTLE
 	u64 k[4];
 	ec_load_k(k_raw, k);
@@ -510,6 +665,8 @@ int snowshoe_mul(const char k_raw[32], const char P[64], char R[64]) {
 }
 
 int snowshoe_simul_gen(const char a[32], const char b[32], const char Q[64], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_SIMUL_GEN, 1);
+
 #ifndef CAT_ENDIAN_LITTLE
 	u64 k1[4+4];
 	u64 *k2 = k1 + 4;
@@ -563,6 +720,8 @@ int snowshoe_simul_gen(const char a[32], const char b[32], const char Q[64], cha
 }
 
 int snowshoe_simul(const char a[32], const char P[64], const char b[32], const char Q[64], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_SIMUL, 1);
+
 #ifndef CAT_ENDIAN_LITTLE
 	u64 k1[4], k2[4];
 	ec_load_k(a, k1);
@@ -615,8 +774,146 @@ int snowshoe_simul(const char a[32], const char P[64], const char b[32], const c
 	return 0;
 }
 
+// k = s0 + s1 * lambda (mod q)
+int snowshoe_short_scalar(const char s[16], char k[32]) {
+#ifndef CAT_ENDIAN_LITTLE
+	u64 s1[2];
+	ec_load_s(s, s1);
+#else
+	const u64 *s1 = (const u64 *)s;
+#endif // CAT_ENDIAN_LITTLE
+
+	// Validate short scalar
+	if (s1[0] == 0) {
+		return -1;
+	}
+
+	const u64 x[4] = { s1[1], 0, 0, 0 };
+	const u64 z[4] = { s1[0], 0, 0, 0 };
+
+#ifndef CAT_ENDIAN_LITTLE
+	u64 r[4];
+	mul_mod_q(x, EC_LAMBDA, z, r);
+	ec_save_k(r, k);
+
+	CAT_SECURE_OBJCLR(s1);
+	CAT_SECURE_OBJCLR(r);
+#else
+	mul_mod_q(x, EC_LAMBDA, z, (u64 *)k);
+#endif // CAT_ENDIAN_LITTLE
+
+	return 0;
+}
+
+int snowshoe_mul_short(const char s[16], const char P[64], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MUL_SHORT, 1);
+
+#ifndef CAT_ENDIAN_LITTLE
+	u64 s1[2];
+	ec_load_s(s, s1);
+
+	// Validate short scalar
+	if (s1[0] == 0) {
+		return -1;
+	}
+
+	// Load point
+	ecpt_affine p, r;
+	ec_load_xy((const u8*)P, p);
+
+	// Validate point
+	if (!ec_valid(p)) {
+		return -1;
+	}
+
+	// Multiply
+	ec_mul_short_affine(s1, p, r);
+
+	// Save result endian-neutral
+	ec_save_xy(r, (u8*)R);
+
+	CAT_SECURE_OBJCLR(s1);
+	CAT_SECURE_OBJCLR(r);
+#else
+	const u64 *s1 = (const u64 *)s;
+	const ecpt_affine *p = (const ecpt_affine *)P;
+
+	// Validate short scalar
+	if (s1[0] == 0) {
+		return -1;
+	}
+
+	// Validate point
+	if (!ec_valid_vartime(*p)) {
+		return -1;
+	}
+
+	// Multiply
+	ec_mul_short_affine(s1, *p, *(ecpt_affine *)R);
+#endif // CAT_ENDIAN_LITTLE
+
+	return 0;
+}
+
+int snowshoe_simul_short(const char sa[16], const char P[64], const char sb[16], const char Q[64], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_SIMUL_SHORT, 1);
+
+#ifndef CAT_ENDIAN_LITTLE
+	u64 s1[2], s2[2];
+	ec_load_s(sa, s1);
+	ec_load_s(sb, s2);
+
+	// Validate short scalars
+	if (s1[0] == 0 || s2[0] == 0) {
+		return -1;
+	}
+
+	// Load points
+	ecpt_affine p1, p2, r;
+	ec_load_xy((const u8*)P, p1);
+	ec_load_xy((const u8*)Q, p2);
+
+	// Validate points
+	if (!ec_valid(p1) || !ec_valid(p2)) {
+		return -1;
+	}
+
+	// Multiply
+	ec_simul_short_affine(s1, p1, s2, p2, r);
+
+	// Save result endian-neutral
+	ec_save_xy(r, (u8*)R);
+
+	CAT_SECURE_OBJCLR(s1);
+	CAT_SECURE_OBJCLR(s2);
+	CAT_SECURE_OBJCLR(r);
+#else
+	const u64 *s1 = (const u64 *)sa;
+	const u64 *s2 = (const u64 *)sb;
+	const ecpt_affine *p1 = (const ecpt_affine *)P;
+	const ecpt_affine *p2 = (const ecpt_affine *)Q;
+
+	// Validate short scalars
+	if (s1[0] == 0 || s2[0] == 0) {
+		return -1;
+	}
+
+	// Validate points
+	if (!ec_valid_vartime(*p1) || !ec_valid_vartime(*p2)) {
+		return -1;
+	}
+
+	// Multiply
+	ec_simul_short_affine(s1, *p1, s2, *p2, *(ecpt_affine *)R);
+#endif // CAT_ENDIAN_LITTLE
+
+	return 0;
+}
+
 // E = Elligator(key)
 int snowshoe_elligator(const char key[32], char E[128]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_ELLIGATOR, 1);
+
 	// Calculate Elligator point from key
 	ecpt_affine p;
 	ec_elligator_decode(key, p);
@@ -643,8 +940,237 @@ int snowshoe_elligator(const char key[32], char E[128]) {
 	return 0;
 }
 
+// E[i] = Elligator(key[i])
+int snowshoe_elligator_batch(const char *keys, int n, char *E) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_ELLIGATOR_BATCH, n);
+
+	int result = 0;
+
+	while (n > 0) {
+		const int count = n < EC_ELLIGATOR_BATCH ? n : EC_ELLIGATOR_BATCH;
+
+		// Calculate Elligator points from keys
+		ecpt_affine p[EC_ELLIGATOR_BATCH];
+		ec_elligator_decode_batch(keys, count, p);
+
+		for (int ii = 0; ii < count; ++ii) {
+			ecpt *e = (ecpt *)(E + ii * 128);
+
+			// Validate the resulting point (ie. 0 -> invalid point)
+			if (!ec_valid_vartime(p[ii])) {
+				memset(e, 0, sizeof(ecpt));
+				result = -1;
+				continue;
+			}
+
+			// q = 4E
+			ecpt q;
+			ec_expand(p[ii], q);
+			ufe t2b;
+			ec_dbl(q, q, true, t2b);
+			ec_dbl(q, q, false, t2b);
+
+			// Fix T coordinate
+			fe_mul(q.t, t2b, q.t);
+
+			// Copy result
+			ec_set(q, *e);
+		}
+
+		keys += count * 32;
+		E += count * 128;
+		n -= count;
+	}
+
+	return result;
+}
+
+// p = 4 * (Elligator(h[0..31]) + Elligator(h[32..63]))
+static void hash_to_curve(const char h[64], ecpt &p) {
+	// Decode both halves without inversions
+	ecpt q;
+	ec_elligator_decode_proj(h, p);
+	ec_elligator_decode_proj(h + 32, q);
+
+	// p = p + q
+	ufe t2b;
+	ec_add(p, q, p, false, true, false, t2b);
+
+	// Clear cofactor
+	ec_dbl(p, p, false, t2b);
+	ec_dbl(p, p, false, t2b);
+}
+
+// R = HashToCurve(h)
+int snowshoe_hash_to_curve(const char h[64], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_HASH_TO_CURVE, 1);
+
+	ecpt p;
+	hash_to_curve(h, p);
+
+	// Affine point
+	ecpt_affine *r = (ecpt_affine *)R;
+	ec_affine(p, *r);
+
+	// Validate the resulting point (ie. 0 -> invalid point)
+	if (!ec_valid_vartime(*r)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+// R[i] = HashToCurve(h[i])
+int snowshoe_hash_to_curve_batch(const char *h, int n, char *R) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_HASH_TO_CURVE_BATCH, n);
+
+	int result = 0;
+
+	while (n > 0) {
+		const int count = n < EC_ELLIGATOR_BATCH ? n : EC_ELLIGATOR_BATCH;
+
+		ecpt p[EC_ELLIGATOR_BATCH];
+		for (int ii = 0; ii < count; ++ii) {
+			hash_to_curve(h + ii * 64, p[ii]);
+		}
+
+		// Affine points with one shared inversion
+		ecpt_affine *r = (ecpt_affine *)R;
+		ufp d[EC_ELLIGATOR_BATCH], scratch[EC_ELLIGATOR_BATCH];
+		ec_affine_batch(p, r, d, scratch, count);
+
+		// Validate the resulting points (ie. 0 -> invalid point)
+		for (int ii = 0; ii < count; ++ii) {
+			if (!ec_valid_vartime(r[ii])) {
+				memset(&r[ii], 0, sizeof(ecpt_affine));
+				result = -1;
+			}
+		}
+
+		h += count * 64;
+		R += count * 64;
+		n -= count;
+	}
+
+	return result;
+}
+
+// R[i] = HashToCurve(h[i]), output in SoA blocks
+int snowshoe_hash_to_curve_batch_soa(const char *h, int n, char *B) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_HASH_TO_CURVE_BATCH, n);
+
+	int result = 0;
+	u8 *b = (u8 *)B;
+
+	for (int offset = 0; offset < n; offset += EC_ELLIGATOR_BATCH) {
+		const int count = n - offset < EC_ELLIGATOR_BATCH ? n - offset : EC_ELLIGATOR_BATCH;
+
+		ecpt p[EC_ELLIGATOR_BATCH];
+		for (int ii = 0; ii < count; ++ii) {
+			hash_to_curve(h + (offset + ii) * 64, p[ii]);
+		}
+
+		// Affine points with one shared inversion
+		ecpt_affine r[EC_ELLIGATOR_BATCH];
+		ufp d[EC_ELLIGATOR_BATCH], scratch[EC_ELLIGATOR_BATCH];
+		ec_affine_batch(p, r, d, scratch, count);
+
+		for (int ii = 0; ii < count; ++ii) {
+			// Validate the resulting point (ie. 0 -> invalid point)
+			if (!ec_valid_vartime(r[ii])) {
+				fe_zero(r[ii].x);
+				fe_zero(r[ii].y);
+				result = -1;
+			}
+
+			const int jj = offset + ii;
+			ec_save_xy_soa(r[ii], b + (jj / EC_SOA_WIDTH) * 512, jj % EC_SOA_WIDTH);
+		}
+	}
+
+	soa_zero_tail(b, n);
+
+	return result;
+}
+
+// R = Elligator^-1(P)
+int snowshoe_elligator_encode(const char P[64], unsigned int noise, char R[32]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_ELLIGATOR_ENCODE, 1);
+
+	// Validate the input point
+	const ecpt_affine *p = (const ecpt_affine *)P;
+	if (!ec_valid_vartime(*p)) {
+		return -1;
+	}
+
+	if (!ec_elligator_encode(*p, noise, R)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+// P = Elligator(R)
+int snowshoe_elligator_decode(const char R[32], char P[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_ELLIGATOR_DECODE, 1);
+
+	// R is public, so it is fine to skip the constant-time inversions
+	ecpt_affine *p = (ecpt_affine *)P;
+	ec_elligator_decode_vartime(R, *p);
+
+	// Validate the resulting point (ie. 0 -> invalid point)
+	if (!ec_valid_vartime(*p)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+// P = k_i G, R = Elligator^-1(P), for the first k_i that works
+int snowshoe_keygen_elligator(const char *k, int n, unsigned int noise, char P[64], char R[32]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_KEYGEN_ELLIGATOR, 1);
+
+	if (n <= 0) {
+		return -1;
+	}
+
+	// Validate all keys before doing any work
+	for (int ii = 0; ii < n; ++ii) {
+		const u64 *key = (const u64 *)(k + ii * 32);
+		if (invalid_key(key)) {
+			return -1;
+		}
+	}
+
+	// About half of the public keys have a representative for the given
+	// noise.  Each attempt uses an independent random key, so the key that
+	// is returned is uniform among those that have one.
+	for (int ii = 0; ii < n; ++ii) {
+		const u64 *key = (const u64 *)(k + ii * 32);
+
+		// K = kG
+		ecpt K;
+		ufe t2b;
+		ec_mul_gen(key, K, t2b);
+
+		ecpt_affine p;
+		ec_affine(K, p);
+
+		char r[32];
+		if (ec_elligator_encode(p, noise, r)) {
+			memcpy(P, &p, 64);
+			memcpy(R, r, 32);
+			return ii;
+		}
+	}
+
+	return -1;
+}
+
 // C = kG + E
 int snowshoe_elligator_encrypt(const char k[32], const char E[128], char C[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_ELLIGATOR_ENCRYPT, 1);
+
 	// K = kG
 	ecpt K;
 	const u64 *key = (const u64 *)k;
@@ -668,6 +1194,8 @@ int snowshoe_elligator_encrypt(const char k[32], const char E[128], char C[64])
 // R = k1(C - E) + k2 * V
 int snowshoe_elligator_secret(const char k1[32], const char C[64], const char E[128],
 							  const char k2[32], const char V[64], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_ELLIGATOR_SECRET, 1);
+
 	// p = C - E
 	ecpt p, q;
 	const ecpt_affine *c = (const ecpt_affine *)C;
@@ -713,7 +1241,975 @@ int snowshoe_elligator_secret(const char k1[32], const char C[64], const char E[
 	return 0;
 }
 
+// P = Prepare(E, V)
+int snowshoe_elligator_prepare(const char E[128], const char V[64], char P[384]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_ELLIGATOR_PREPARE, 1);
+
+	ec_verifier *prep = (ec_verifier *)P;
+
+	// ne = -E
+	const ecpt *e = (const ecpt *)E;
+	ec_neg(*e, prep->ne);
+
+	// If V is provided,
+	if (V) {
+		const ecpt_affine *v = (const ecpt_affine *)V;
+		if (!ec_valid_vartime(*v)) {
+			return -1;
+		}
+
+		// Expand V and its endomorphism
+		ec_prepare(*v, prep->v);
+	} else {
+		memset(&prep->v, 0, sizeof(prep->v));
+	}
+
+	return 0;
+}
+
+// R = k1(C - E) + k2 * V
+int snowshoe_elligator_secret_prepared(const char k1[32], const char C[64], const char P[384],
+									   const char k2[32], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_ELLIGATOR_SECRET_PREPARED, 1);
+
+	const ec_verifier *prep = (const ec_verifier *)P;
+
+	// Validate keys
+	const u64 *key1 = (const u64 *)k1;
+	if (invalid_key(key1)) {
+		return -1;
+	}
+
+	// p = C - E
+	const ecpt_affine *c = (const ecpt_affine *)C;
+	if (!ec_valid_vartime(*c)) {
+		return -1;
+	}
+	ecpt p;
+	ec_expand(*c, p);
+	ufe t2b;
+	ec_add(prep->ne, p, p, true, true, true, t2b);
+
+	// If only a single multiplication is required,
+	if (!k2) {
+		// p = k1 * p
+		ec_mul(key1, p, false, p, t2b);
+	} else {
+		// If V was not prepared,
+		if (fe_iszero_vartime(prep->v.p.x)) {
+			return -1;
+		}
+
+		const u64 *key2 = (const u64 *)k2;
+		if (invalid_key(key2)) {
+			return -1;
+		}
+
+		// p = k1 * p + k2 * V
+		ec_simul_prep(key1, p, false, key2, prep->v, p, t2b);
+	}
+
+	// Fix small subgroup attack
+	ec_dbl(p, p, false, t2b);
+	ec_dbl(p, p, false, t2b);
+
+	// Affine point
+	ecpt_affine *r = (ecpt_affine *)R;
+	ec_affine(p, *r);
+
+	return 0;
+}
+
+// Size of a key directory
+long long snowshoe_keydir_size(int n, int prepared) {
+	if (n < 0) {
+		return -1;
+	}
+
+	const long long record_bytes = sizeof(keydir_record) + (prepared ? sizeof(ecpt) * 16 : 0);
+
+	return sizeof(keydir_header) + record_bytes * n;
+}
+
+// Build a key directory
+int snowshoe_keydir_build(const char *ids, const char *P, int n, int prepared, char *dir) {
+	if (n < 0) {
+		return -1;
+	}
+
+	const u64 flags = prepared ? KEYDIR_PREPARED : 0;
+	const long long record_bytes = sizeof(keydir_record) + (prepared ? sizeof(ecpt) * 16 : 0);
+	char *records = dir + sizeof(keydir_header);
+
+	// Copy and validate the points
+	for (int ii = 0; ii < n; ++ii) {
+		keydir_record *r = (keydir_record *)(records + ii * record_bytes);
+
+		memset(r, 0, sizeof(keydir_record));
+		memcpy(r->id, ids + ii * 32, 32);
+		ec_load_xy((const u8 *)P + ii * 64, r->p);
+		r->flags = flags;
+
+		if (!ec_valid_vartime(r->p)) {
+			return -1;
+		}
+	}
+
+	// Sort by id
+	qsort(records, n, (size_t)record_bytes, keydir_compare);
+
+	for (int ii = 0; ii < n; ++ii) {
+		keydir_record *r = (keydir_record *)(records + ii * record_bytes);
+
+		// Reject duplicate ids
+		if (ii > 0 && keydir_compare(r, records + (ii - 1) * record_bytes) == 0) {
+			return -1;
+		}
+
+		if (prepared) {
+			ec_gen_table_2_prep(r->p, (ecpt (*)[8])(r + 1));
+		}
+
+		r->checksum = keydir_record_checksum(r);
+	}
+
+	keydir_header *h = (keydir_header *)dir;
+	memset(h, 0, sizeof(keydir_header));
+	h->magic = KEYDIR_MAGIC;
+	h->version = KEYDIR_VERSION;
+	h->flags = (u32)flags;
+	h->count = n;
+	h->record_bytes = record_bytes;
+	h->checksum = keydir_checksum((const u64 *)h, 4, 0x9E3779B97F4A7C15ULL);
+
+	return 0;
+}
+
+// Check a key directory
+int snowshoe_keydir_open(const char *dir, long long size) {
+	if (size < (long long)sizeof(keydir_header)) {
+		return -1;
+	}
+
+	const keydir_header *h = (const keydir_header *)dir;
+
+	if (h->magic != KEYDIR_MAGIC || h->version != KEYDIR_VERSION ||
+		h->checksum != keydir_checksum((const u64 *)h, 4, 0x9E3779B97F4A7C15ULL)) {
+		return -1;
+	}
+
+	const u64 prepared = h->flags & KEYDIR_PREPARED;
+	if (h->record_bytes != sizeof(keydir_record) + (prepared ? sizeof(ecpt) * 16 : 0)) {
+		return -1;
+	}
+
+	// Check the size without overflowing
+	if ((u64)(size - sizeof(keydir_header)) / h->record_bytes != h->count ||
+		(u64)(size - sizeof(keydir_header)) % h->record_bytes != 0) {
+		return -1;
+	}
+
+	// Verify the records once here rather than on every lookup
+	const char *records = dir + sizeof(keydir_header);
+	for (u64 ii = 0; ii < h->count; ++ii) {
+		const keydir_record *r = (const keydir_record *)(records + ii * h->record_bytes);
+
+		if (r->checksum != keydir_record_checksum(r) ||
+			(r->flags & KEYDIR_PREPARED) != prepared) {
+			return -1;
+		}
+
+		// Binary search needs the ids sorted and unique
+		if (ii > 0 && keydir_compare(r, records + (ii - 1) * h->record_bytes) <= 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+// Find an entry by id
+const char *snowshoe_keydir_find(const char *dir, const char id[32]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_KEYDIR_FIND, 1);
+
+	const keydir_header *h = (const keydir_header *)dir;
+	const char *records = dir + sizeof(keydir_header);
+
+	// Binary search
+	u64 lo = 0, hi = h->count;
+	while (lo < hi) {
+		const u64 mid = lo + (hi - lo) / 2;
+		const keydir_record *r = (const keydir_record *)(records + mid * h->record_bytes);
+
+		const int c = keydir_compare(r->id, id);
+		if (c == 0) {
+			CAT_STATS_KEYDIR(true);
+			return (const char *)r;
+		} else if (c < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	CAT_STATS_KEYDIR(false);
+	return 0;
+}
+
+// R = 4aG + 4bQ, Q from a key directory entry
+int snowshoe_keydir_simul_gen(const char a[32], const char b[32], const char *entry, char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_KEYDIR_SIMUL_GEN, 1);
+
+	const u64 *k1 = (const u64 *)a;
+	const u64 *k2 = (const u64 *)b;
+	const keydir_record *r = (const keydir_record *)entry;
+
+	// Validate keys
+	if (invalid_key(k1) || invalid_key(k2)) {
+		return -1;
+	}
+
+	// The point was validated when the directory was built
+	if (r->flags & KEYDIR_PREPARED) {
+		ec_simul_gen_prep_affine(k1, k2, (const ecpt (*)[8])(r + 1), *(ecpt_affine *)R);
+	} else {
+		ec_simul_gen_affine(k1, k2, r->p, *(ecpt_affine *)R);
+	}
+
+	return 0;
+}
+
+// Operation counts for this thread
+int snowshoe_counts_snapshot(snowshoe_counts *counts) {
+#ifdef CAT_SNOWSHOE_COUNT_OPS
+	memcpy(counts, m_op_counts, sizeof(m_op_counts));
+
+	return 0;
+#else
+	memset(counts, 0, sizeof(snowshoe_counts));
+
+	return -1;
+#endif
+}
+
+// Size of the multi-scalar multiplication state
+int snowshoe_msm_size() {
+	return sizeof(ecpt) * EC_MSM_WINDOWS * EC_MSM_BUCKETS;
+}
+
+// Reset the state to an empty sum
+void snowshoe_msm_init(char *state) {
+	ec_msm_init((ecpt *)state);
+}
+
+// state += sum(k_i * P_i)
+int snowshoe_msm_update(char *state, const char *terms, int n) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MSM_UPDATE, n);
+
+	ecpt *buckets = (ecpt *)state;
+
+#ifndef CAT_ENDIAN_LITTLE
+	// Validate all of the points before changing the state
+	for (int ii = 0; ii < n; ++ii) {
+		ecpt_affine p;
+		ec_load_xy((const u8 *)terms + ii * 96 + 32, p);
+
+		if (!ec_valid_vartime(p)) {
+			return -1;
+		}
+	}
+
+	for (int ii = 0; ii < n; ++ii) {
+		const char *term = terms + ii * 96;
+
+		u64 k[4];
+		ecpt_affine p;
+		ec_load_k(term, k);
+		ec_load_xy((const u8 *)term + 32, p);
+
+		ec_msm_add(buckets, k, p);
+	}
+#else
+	// Validate all of the points before changing the state
+	for (int ii = 0; ii < n; ++ii) {
+		if (!ec_valid_vartime(*(const ecpt_affine *)(terms + ii * 96 + 32))) {
+			return -1;
+		}
+	}
+
+	for (int ii = 0; ii < n; ++ii) {
+		const char *term = terms + ii * 96;
+
+		ec_msm_add(buckets, (const u64 *)term, *(const ecpt_affine *)(term + 32));
+	}
+#endif
+
+	return 0;
+}
+
+// state += other
+void snowshoe_msm_merge(char *state, const char *other) {
+	ec_msm_merge((ecpt *)state, (const ecpt *)other);
+}
+
+// R = 4 * sum(k_i * P_i)
+void snowshoe_msm_finish(const char *state, char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MSM_FINISH, 1);
+
+	ecpt_affine r;
+	ec_msm_finish((const ecpt *)state, r);
+
+	ec_save_xy(r, (u8 *)R);
+}
+
+// S = sum(z_i * s_i) (mod q)
+void snowshoe_sig_aggregate(const char *z, const char *s, int n, char S[32]) {
+	u64 sum[4] = { 0, 0, 0, 0 };
+
+	for (int ii = 0; ii < n; ++ii) {
+#ifndef CAT_ENDIAN_LITTLE
+		u64 zi[4], si[4];
+		ec_load_k(z + ii * 32, zi);
+		ec_load_k(s + ii * 32, si);
+#else
+		const u64 *zi = (const u64 *)(z + ii * 32);
+		const u64 *si = (const u64 *)(s + ii * 32);
+#endif
+
+		mul_mod_q(zi, si, sum, sum);
+	}
+
+#ifndef CAT_ENDIAN_LITTLE
+	ec_save_k(sum, S);
+#else
+	memcpy(S, sum, 32);
+#endif
+}
+
+/*
+ * Pairwise sum for a few terms
+ *
+ * The buckets cost a fixed setup and summation that only pays off with
+ * many terms.  For a few terms it is faster to pair them up with ec_simul,
+ * keeping one term back until its partner arrives.
+ *
+ * Scalars are reduced mod q, and terms with a zero scalar are skipped.
+ *
+ * WARNING: Not constant time.  Only for public scalars and points.
+ */
+
+struct ec_pair_sum {
+	ecpt X, P;
+	u64 k[4];
+	bool held;
+};
+
+static void ec_pair_sum_init(ec_pair_sum &s) {
+	ec_identity(s.X);
+	s.held = false;
+}
+
+// s += k * P
+static void ec_pair_sum_add(ec_pair_sum &s, const u64 k0[4], const ecpt_affine &P0) {
+	static const u64 ONE[4] = { 1, 0, 0, 0 };
+
+	u64 k[4];
+	mul_mod_q(k0, ONE, 0, k);
+	if (is_zero(k)) {
+		return;
+	}
+
+	if (!s.held) {
+		memcpy(s.k, k, sizeof(k));
+		ec_expand(P0, s.P);
+		s.held = true;
+		return;
+	}
+
+	ecpt P, Y;
+	ufe t2b;
+	ec_expand(P0, P);
+	ec_simul(s.k, s.P, true, k, P, true, Y, t2b);
+	ec_add(Y, s.X, Y, false, false, true, t2b);
+	ec_set(Y, s.X);
+	s.held = false;
+}
+
+// X = sum of the terms added
+static void ec_pair_sum_finish(ec_pair_sum &s, ecpt &X) {
+	if (s.held) {
+		ecpt Y;
+		ufe t2b;
+		ec_mul(s.k, s.P, true, Y, t2b);
+		ec_add(Y, s.X, Y, false, false, true, t2b);
+		ec_set(Y, s.X);
+		s.held = false;
+	}
+
+	ec_set(s.X, X);
+}
+
+// Fewest signatures for which the bucket setup and summation pay off
+static const int SIG_AGGREGATE_MSM_MIN = 128;
+
+// 4 * (sum(z_i * R_i) + sum(4 * z_i * t_i * A_i) - 4 * S * G) = 0
+int snowshoe_sig_verify_aggregate(const char *z, const char *t, const char *A, const char *R, int n, const char S[32]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_SIG_VERIFY_AGGREGATE, n);
+
+	static const u64 FOUR[4] = { 4, 0, 0, 0 };
+
+#ifndef CAT_ENDIAN_LITTLE
+	u64 s[4];
+	ec_load_k(S, s);
+#else
+	const u64 *s = (const u64 *)S;
+#endif
+
+	if (n < 1 || !less_q(s)) {
+		return -1;
+	}
+
+	// c = -4S (mod q)
+	u64 c[4];
+	mul_mod_q(s, FOUR, 0, c);
+	if (!is_zero(c)) {
+		neg_mod_q(c, c);
+	}
+
+	// Few signatures are summed in pairs rather than in buckets
+	ecpt *buckets = 0;
+	ec_pair_sum pairs;
+
+	if (n >= SIG_AGGREGATE_MSM_MIN) {
+		buckets = new (std::nothrow) ecpt[EC_MSM_WINDOWS * EC_MSM_BUCKETS];
+		if (!buckets) {
+			return -1;
+		}
+
+		ec_msm_init(buckets);
+	} else {
+		ec_pair_sum_init(pairs);
+	}
+
+	// The last A term is held back to share a multiplication with the G term
+	u64 wlast[4];
+	ecpt_affine alast;
+	bool have_last = false;
+	int result = 0;
+
+	for (int ii = 0; ii < n; ++ii) {
+#ifndef CAT_ENDIAN_LITTLE
+		u64 zi[4], ti[4];
+		ec_load_k(z + ii * 32, zi);
+		ec_load_k(t + ii * 32, ti);
+#else
+		const u64 *zi = (const u64 *)(z + ii * 32);
+		const u64 *ti = (const u64 *)(t + ii * 32);
+#endif
+
+		// Validate points
+		ecpt_affine a, r;
+		ec_load_xy((const u8 *)A + ii * 64, a);
+		ec_load_xy((const u8 *)R + ii * 64, r);
+
+		if (!ec_valid_vartime(a) || !ec_valid_vartime(r)) {
+			result = -1;
+			break;
+		}
+
+		if (buckets) {
+			ec_msm_add(buckets, zi, r);
+		} else {
+			ec_pair_sum_add(pairs, zi, r);
+		}
+
+		// w = 4 * z_i * t_i (mod q)
+		u64 w[4];
+		mul_mod_q(zi, ti, 0, w);
+		mul_mod_q(w, FOUR, 0, w);
+
+		if (!is_zero(w)) {
+			if (have_last) {
+				if (buckets) {
+					ec_msm_add(buckets, wlast, alast);
+				} else {
+					ec_pair_sum_add(pairs, wlast, alast);
+				}
+			}
+
+			memcpy(wlast, w, sizeof(w));
+			alast = a;
+			have_last = true;
+		}
+	}
+
+	if (result == 0) {
+		ecpt X, Y;
+		ufe t2b;
+		if (buckets) {
+			ec_msm_sum(buckets, X);
+		} else {
+			ec_pair_sum_finish(pairs, X);
+		}
+
+		// Y = cG + w * A using the fixed-base comb for G
+		if (have_last) {
+			ecpt P;
+			ec_expand(alast, P);
+			ec_simul_gen(c, wlast, P, true, Y, t2b);
+		} else {
+			ec_mul_gen(c, Y, t2b);
+		}
+
+		ec_add(Y, X, Y, false, false, false, t2b);
+
+		// Multiply by 4 to avoid small subgroup attack
+		ec_dbl(Y, Y, false, t2b);
+		ec_dbl(Y, Y, false, t2b);
+
+		if (!ec_isidentity_vartime(Y)) {
+			result = -1;
+		}
+	}
+
+	delete[] buckets;
+
+	return result;
+}
+
+// X = sum(c_i * A_i)
+int snowshoe_musig_key(const char *c, const char *A, int n, char X[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MUSIG_KEY, n);
+
+	if (n < 1) {
+		return -1;
+	}
+
+	ecpt S, Y;
+	ufe t2b;
+	ec_identity(S);
+
+	// Two terms per simultaneous multiplication
+	for (int ii = 0; ii < n; ii += 2) {
+		const int m = n - ii >= 2 ? 2 : 1;
+
+		ecpt P[2];
+#ifndef CAT_ENDIAN_LITTLE
+		u64 k[2][4];
+#else
+		const u64 *k[2];
+#endif
+
+		for (int jj = 0; jj < m; ++jj) {
+#ifndef CAT_ENDIAN_LITTLE
+			ec_load_k(c + (ii + jj) * 32, k[jj]);
+#else
+			k[jj] = (const u64 *)(c + (ii + jj) * 32);
+#endif
+
+			ecpt_affine a;
+			ec_load_xy((const u8 *)A + (ii + jj) * 64, a);
+
+			if (invalid_key(k[jj]) || !ec_valid_vartime(a)) {
+				return -1;
+			}
+
+			ec_expand(a, P[jj]);
+		}
+
+		if (m == 2) {
+			ec_simul(k[0], P[0], true, k[1], P[1], true, Y, t2b);
+		} else {
+			ec_mul(k[0], P[0], true, Y, t2b);
+		}
+
+		ec_add(Y, S, Y, false, false, true, t2b);
+		ec_set(Y, S);
+	}
+
+	// Public keys only
+	ecpt_affine x;
+	ec_affine_vartime(S, x);
+
+	// If the keys cancelled out,
+	if (fe_iszero_vartime(x.x)) {
+		return -1;
+	}
+
+	ec_save_xy(x, (u8 *)X);
+
+	return 0;
+}
+
+// N = (4 * r1 * G, 4 * r2 * G)
+int snowshoe_musig_nonce(const char r[64], char N[128]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MUSIG_NONCE, 1);
+
+#ifndef CAT_ENDIAN_LITTLE
+	u64 k[4+4];
+	ec_load_k(r, k);
+	ec_load_k(r + 32, k + 4);
+#else
+	const u64 *k = (const u64 *)r;
+#endif
+
+	// Validate keys
+	if (invalid_key(k) || invalid_key(k + 4)) {
+		return -1;
+	}
+
+	for (int ii = 0; ii < 2; ++ii) {
+		ecpt_affine n;
+		ecpt p;
+		ufe p2b;
+		ec_mul_gen(k + ii * 4, p, p2b);
+		ec_dbl(p, p, false, p2b);
+		ec_dbl(p, p, false, p2b);
+		ec_affine(p, n);
+
+		ec_save_xy(n, (u8 *)N + ii * 64);
+
+#ifndef CAT_ENDIAN_LITTLE
+		CAT_SECURE_OBJCLR(n);
+		CAT_SECURE_OBJCLR(p);
+#endif
+	}
+
+#ifndef CAT_ENDIAN_LITTLE
+	CAT_SECURE_OBJCLR(k);
+#endif
+
+	return 0;
+}
+
+// NA = sum(N_i)
+int snowshoe_musig_nonce_agg(const char *N, int n, char NA[128]) {
+	if (n < 1) {
+		return -1;
+	}
+
+	ecpt S[2];
+	ec_identity(S[0]);
+	ec_identity(S[1]);
+
+	ufe t2b;
+	for (int ii = 0; ii < n * 2; ++ii) {
+		ecpt_affine a;
+		ec_load_xy((const u8 *)N + ii * 64, a);
+
+		if (!ec_valid_vartime(a)) {
+			return -1;
+		}
+
+		ecpt P;
+		ec_expand(a, P);
+
+		ec_add(S[ii & 1], P, S[ii & 1], true, true, true, t2b);
+	}
+
+	// Public nonces only
+	for (int ii = 0; ii < 2; ++ii) {
+		ecpt_affine x;
+		ec_affine_vartime(S[ii], x);
+		ec_save_xy(x, (u8 *)NA + ii * 64);
+	}
+
+	return 0;
+}
+
+// R = N1 + b * N2
+static void musig_nonce_final(const ecpt_affine &n1, const ecpt_affine &n2, const u64 b[4], ecpt_affine &R) {
+	ecpt P, Y;
+	ufe t2b;
+
+	ec_expand(n2, P);
+	ec_mul(b, P, true, Y, t2b);
+
+	ec_expand(n1, P);
+	ec_add(Y, P, Y, true, false, false, t2b);
+
+	// Public nonces and b only
+	ec_affine_vartime(Y, R);
+}
+
+// Load and validate a nonce pair and b for musig_nonce_final
+static bool musig_load_nonce(const char N[128], const char b_chars[32], ecpt_affine n[2], u64 b[4]) {
+#ifndef CAT_ENDIAN_LITTLE
+	ec_load_k(b_chars, b);
+#else
+	memcpy(b, b_chars, 32);
+#endif
+
+	ec_load_xy((const u8 *)N, n[0]);
+	ec_load_xy((const u8 *)N + 64, n[1]);
+
+	return !invalid_key(b) && ec_valid_vartime(n[0]) && ec_valid_vartime(n[1]);
+}
+
+// R = N1 + b * N2
+int snowshoe_musig_nonce_final(const char NA[128], const char b[32], char R[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MUSIG_NONCE_FINAL, 1);
+
+	ecpt_affine n[2], r;
+	u64 k[4];
+
+	if (!musig_load_nonce(NA, b, n, k)) {
+		return -1;
+	}
+
+	musig_nonce_final(n[0], n[1], k, r);
+
+	ec_save_xy(r, (u8 *)R);
+
+	return 0;
+}
+
+// s = c * t * a + r1 + b * r2 (mod q)
+int snowshoe_musig_sign(const char a[32], const char c[32], const char r[64], const char b[32], const char t[32], char s[32]) {
+#ifndef CAT_ENDIAN_LITTLE
+	u64 k[4*6];
+	u64 *a1 = k, *c1 = k + 4, *r1 = k + 8, *r2 = k + 12, *b1 = k + 16, *t1 = k + 20;
+	ec_load_k(a, a1);
+	ec_load_k(c, c1);
+	ec_load_k(r, r1);
+	ec_load_k(r + 32, r2);
+	ec_load_k(b, b1);
+	ec_load_k(t, t1);
+#else
+	const u64 *a1 = (const u64 *)a;
+	const u64 *c1 = (const u64 *)c;
+	const u64 *r1 = (const u64 *)r;
+	const u64 *r2 = (const u64 *)(r + 32);
+	const u64 *b1 = (const u64 *)b;
+	const u64 *t1 = (const u64 *)t;
+#endif
+
+	int result = -1;
+
+	// Validate keys
+	if (!invalid_key(a1) && !invalid_key(r1) && !invalid_key(r2) &&
+		less_q(c1) && less_q(b1) && less_q(t1)) {
+		u64 e[4], u[4];
+
+		// e = c * t, u = b * r2 + r1
+		mul_mod_q(c1, t1, 0, e);
+		mul_mod_q(b1, r2, r1, u);
+
+		// s = e * a + u
+		mul_mod_q(e, a1, u, e);
+
+#ifndef CAT_ENDIAN_LITTLE
+		ec_save_k(e, s);
+
+		CAT_SECURE_OBJCLR(e);
+		CAT_SECURE_OBJCLR(u);
+#else
+		memcpy(s, e, 32);
+#endif
+
+		result = 0;
+	}
+
+#ifndef CAT_ENDIAN_LITTLE
+	CAT_SECURE_OBJCLR(k);
+#endif
+
+	return result;
+}
+
+// 4 * s * G - 4 * c * t * A = N1 + b * N2
+int snowshoe_musig_verify_partial(const char A[64], const char c[32], const char N[128], const char b[32], const char t[32], const char s[32]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_MUSIG_VERIFY_PARTIAL, 1);
+
+#ifndef CAT_ENDIAN_LITTLE
+	u64 c1[4], t1[4], s1[4];
+	ec_load_k(c, c1);
+	ec_load_k(t, t1);
+	ec_load_k(s, s1);
+#else
+	const u64 *c1 = (const u64 *)c;
+	const u64 *t1 = (const u64 *)t;
+	const u64 *s1 = (const u64 *)s;
+#endif
+
+	ecpt_affine n[2], a, r, x;
+	u64 k[4];
+
+	if (!musig_load_nonce(N, b, n, k)) {
+		return -1;
+	}
+
+	ec_load_xy((const u8 *)A, a);
+
+	if (invalid_key(s1) || !less_q(c1) || !less_q(t1) || !ec_valid_vartime(a)) {
+		return -1;
+	}
+
+	// e = -c * t (mod q)
+	u64 e[4];
+	mul_mod_q(c1, t1, 0, e);
+	if (is_zero(e)) {
+		return -1;
+	}
+	neg_mod_q(e, e);
+
+	musig_nonce_final(n[0], n[1], k, r);
+
+	// x = 4 * s * G - 4 * c * t * A, where everything is public
+	ecpt X;
+	ufe t2b;
+	ec_expand(a, X);
+	ec_simul_gen(s1, e, X, true, X, t2b);
+	ec_dbl(X, X, false, t2b);
+	ec_dbl(X, X, false, t2b);
+	ec_affine_vartime(X, x);
+
+	u8 rb[64], xb[64];
+	ec_save_xy(r, rb);
+	ec_save_xy(x, xb);
+
+	return memcmp(rb, xb, 64) ? -1 : 0;
+}
+
+// S = sum(s_i) (mod q)
+void snowshoe_musig_combine(const char *s, int n, char S[32]) {
+	u64 sum[4] = { 0, 0, 0, 0 };
+
+	for (int ii = 0; ii < n; ++ii) {
+#ifndef CAT_ENDIAN_LITTLE
+		u64 si[4];
+		ec_load_k(s + ii * 32, si);
+#else
+		const u64 *si = (const u64 *)(s + ii * 32);
+#endif
+
+		add_mod_q(sum, si, sum);
+	}
+
+#ifndef CAT_ENDIAN_LITTLE
+	ec_save_k(sum, S);
+#else
+	memcpy(S, sum, 32);
+#endif
+}
+
+// Commitment scalars: 0 <= k < q and 0 < r < q
+static CAT_INLINE bool invalid_commit(const u64 k[4], const u64 r[4]) {
+	return !less_q(k) || invalid_key(r);
+}
+
+// C = kG + rH
+int snowshoe_commit(const char k_raw[32], const char r_raw[32], char C[64]) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_COMMIT, 1);
+
+#ifndef CAT_ENDIAN_LITTLE
+	u64 k[4], r[4];
+	ec_load_k(k_raw, k);
+	ec_load_k(r_raw, r);
+
+	if (invalid_commit(k, r)) {
+		return -1;
+	}
+
+	ecpt_affine c;
+	ecpt p;
+	ufe p2b;
+	ec_commit(k, r, p, p2b);
+	ec_affine(p, c);
+
+	// Save result endian-neutral
+	ec_save_xy(c, (u8*)C);
+
+	CAT_SECURE_OBJCLR(k);
+	CAT_SECURE_OBJCLR(r);
+	CAT_SECURE_OBJCLR(c);
+#else
+	const u64 *k = (const u64 *)k_raw;
+	const u64 *r = (const u64 *)r_raw;
+
+	if (invalid_commit(k, r)) {
+		return -1;
+	}
+
+	ecpt p;
+	ufe p2b;
+	ec_commit(k, r, p, p2b);
+	ec_affine(p, *(ecpt_affine *)C);
+#endif // CAT_ENDIAN_LITTLE
+
+	return 0;
+}
+
+// C[i] = k[i]G + r[i]H
+int snowshoe_commit_batch(const char *k_raw, const char *r_raw, int n, char *C) {
+	CAT_STATS_SCOPE(SNOWSHOE_STAT_COMMIT_BATCH, n);
+
+	// Validate every scalar before writing any output
+	for (int ii = 0; ii < n; ++ii) {
+#ifndef CAT_ENDIAN_LITTLE
+		u64 k[4], r[4];
+		ec_load_k(k_raw + ii * 32, k);
+		ec_load_k(r_raw + ii * 32, r);
+#else
+		const u64 *k = (const u64 *)(k_raw + ii * 32);
+		const u64 *r = (const u64 *)(r_raw + ii * 32);
+#endif
+
+		if (invalid_commit(k, r)) {
+			return -1;
+		}
+	}
+
+	while (n > 0) {
+		const int count = n < EC_COMMIT_BATCH ? n : EC_COMMIT_BATCH;
+
+		ecpt p[EC_COMMIT_BATCH];
+		for (int ii = 0; ii < count; ++ii) {
+#ifndef CAT_ENDIAN_LITTLE
+			u64 k[4], r[4];
+			ec_load_k(k_raw + ii * 32, k);
+			ec_load_k(r_raw + ii * 32, r);
+#else
+			const u64 *k = (const u64 *)(k_raw + ii * 32);
+			const u64 *r = (const u64 *)(r_raw + ii * 32);
+#endif
+
+			ufe p2b;
+			ec_commit(k, r, p[ii], p2b);
+
+#ifndef CAT_ENDIAN_LITTLE
+			CAT_SECURE_OBJCLR(k);
+			CAT_SECURE_OBJCLR(r);
+#endif
+		}
+
+		// Affine points with one shared inversion
+		ecpt_affine c[EC_COMMIT_BATCH];
+		ufp d[EC_COMMIT_BATCH], scratch[EC_COMMIT_BATCH];
+		ec_affine_batch(p, c, d, scratch, count);
+
+		for (int ii = 0; ii < count; ++ii) {
+			ec_save_xy(c[ii], (u8*)C + ii * 64);
+		}
+
+#ifndef CAT_ENDIAN_LITTLE
+		CAT_SECURE_OBJCLR(p);
+		CAT_SECURE_OBJCLR(c);
+#endif
+
+		k_raw += count * 32;
+		r_raw += count * 32;
+		C += count * 64;
+		n -= count;
+	}
+
+	return 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
 
+#include "pool.inc"
+#include "ring.inc"
+#include "coalesce.inc"
@@ -141,8 +141,8 @@ static void ec_print_xy(const ecpt_affine &p) {
 
 //#define EC_GEN_PRINT_TABLES
 
-// Verify generator multiplication tables are correct
-static bool ec_gen_tables_comb_test() {
+// Verify comb multiplication tables for base point P are correct
+static bool ec_gen_tables_comb_test(const ecpt &P, const ecpt_affine *const expected[MG_v], const ecpt *fix) {
 	ecpt_affine table[MG_v][MG_width];
 
 	const int ul = 1 << (MG_w - 1);
@@ -154,10 +154,10 @@ static bool ec_gen_tables_comb_test() {
 			ufe t2b;
 			ecpt q, s;
 
-			ec_set(EC_G, q);
+			ec_set(P, q);
 
 #ifdef EC_GEN_PRINT_TABLES
-			ec_set(EC_G, s);
+			ec_set(P, s);
 			for (int jj = 0; jj < (MG_d * MG_w); ++jj) {
 				ec_dbl(s, s, false, t2b);
 			}
@@ -176,7 +176,7 @@ static bool ec_gen_tables_comb_test() {
 
 			for (int ii = 0; ii < (MG_w - 1); ++ii) {
 				if (u & (1 << ii)) {
-					ec_set(EC_G, s);
+					ec_set(P, s);
 					for (int jj = 0; jj < (MG_d * (ii + 1)); ++jj) {
 						ec_add(s, s, s, false, true, true, t2b);
 					}
@@ -211,14 +211,55 @@ static bool ec_gen_tables_comb_test() {
 #endif
 
 	for (int jj = 0; jj < MG_v; ++jj) {
-		if (0 != memcmp(table[jj], GEN_TABLE[jj], sizeof(table[jj]))) {
+		if (0 != memcmp(table[jj], expected[jj], sizeof(table[jj]))) {
 			return false;
 		}
 	}
 
+	// Carry correction: 2^(d*w) * P with Z = 1
+	ufe t2b;
+	ecpt s;
+	ec_set(P, s);
+	for (int jj = 0; jj < (MG_d * MG_w); ++jj) {
+		ec_dbl(s, s, false, t2b);
+	}
+	ecpt_affine sa;
+	ec_affine(s, sa);
+	ec_expand(sa, s);
+
+	if (0 != memcmp(&s, fix, sizeof(s))) {
+		return false;
+	}
+
 	return true;
 }
 
+// Verify the commitment base point H is the hash of the digits of pi
+static bool ec_gen_h_test() {
+	static const u8 PI[64] = {
+		0x24, 0x3F, 0x6A, 0x88, 0x85, 0xA3, 0x08, 0xD3, 0x13, 0x19, 0x8A, 0x2E, 0x03, 0x70, 0x73, 0x44,
+		0xA4, 0x09, 0x38, 0x22, 0x29, 0x9F, 0x31, 0xD0, 0x08, 0x2E, 0xFA, 0x98, 0xEC, 0x4E, 0x6C, 0x89,
+		0x45, 0x28, 0x21, 0xE6, 0x38, 0xD0, 0x13, 0x77, 0xBE, 0x54, 0x66, 0xCF, 0x34, 0xE9, 0x0C, 0x6C,
+		0xC0, 0xAC, 0x29, 0xB7, 0xC9, 0x7C, 0x50, 0xDD, 0x3F, 0x84, 0xD5, 0xB5, 0xB5, 0x47, 0x09, 0x17
+	};
+
+	// H = 4 * (Elligator(PI[0..31]) + Elligator(PI[32..63]))
+	ecpt p, q;
+	ufe t2b;
+	ec_elligator_decode_proj((const char *)PI, p);
+	ec_elligator_decode_proj((const char *)PI + 32, q);
+	ec_add(p, q, p, false, true, false, t2b);
+	ec_dbl(p, p, false, t2b);
+	ec_dbl(p, p, false, t2b);
+
+	ecpt_affine h, expected;
+	ec_affine(p, h);
+	expected.x = EC_H.x;
+	expected.y = EC_H.y;
+
+	return ec_isequal_xy(h, expected);
+}
+
 static bool ec_gen_tables3_comb_test() {
 	//const int t = 252;
 	const int w = 8;
@@ -278,6 +319,35 @@ static bool ec_gen_tables3_comb_test() {
 	return true;
 }
 
+// Verify precomputed tables are aligned to cache lines
+static bool ec_precomp_alignment_test() {
+	for (int vp = 0; vp < MG_v; ++vp) {
+		if ((size_t)GEN_TABLE[vp] & 63) {
+			return false;
+		}
+	}
+
+	if ((size_t)GEN_FIX & 63) {
+		return false;
+	}
+
+	for (int vp = 0; vp < MG_v; ++vp) {
+		if ((size_t)H_TABLE[vp] & 63) {
+			return false;
+		}
+	}
+
+	if ((size_t)H_FIX & 63) {
+		return false;
+	}
+
+	if ((size_t)SIMUL_GEN_TABLE & 63) {
+		return false;
+	}
+
+	return true;
+}
+
 static bool ec_gen_table_2_test() {
 	ecpt a, b;
 
@@ -536,6 +606,254 @@ static bool ec_simul_ref(const u64 k1[4], const ecpt_affine &P0, const u64 k2[4]
 }
 
 
+// r = x * y, schoolbook
+static void mul_ref_product(const u64 x[4], const u64 y[4], u64 r[8]) {
+	for (int ii = 0; ii < 8; ++ii) {
+		r[ii] = 0;
+	}
+
+	for (int ii = 0; ii < 4; ++ii) {
+		u64 carry = 0;
+		for (int jj = 0; jj < 4; ++jj) {
+			u128 prod = u128_prod_sum(x[ii], y[jj], r[ii + jj]);
+			u128_add(prod, carry);
+			r[ii + jj] = u128_low(prod);
+			carry = u128_high(prod);
+		}
+		r[ii + 4] = carry;
+	}
+}
+
+// r = p (mod q), where p < 2^512
+// Generic division-based version that mod_q() replaced, kept to check it
+static void mod_q_ref(const u64 p[8], u64 r[4]) {
+	u64 t[7], n[8];
+	u128 sum, prod;
+
+	/*
+	 * Using the Unsigned Division algorithm from section 4 of [2]:
+	 *
+	 * Computing quot = n / d
+	 *
+	 * d = q < 2^252, l = 252
+	 * p < 2^512, N = 512
+	 *
+	 * m' = 2^N * (2^l - d) / d + 1
+	 * = 2^(N+l)/d - 2^N + 1
+	 *
+	 * t := (m' * p) div (2^N);
+	 *
+	 * s := t + ((p - t) div 2);
+	 *
+	 * quot := s div (2^(l-1));
+	 *
+	 * See magma_unsigned_remainder.txt for more details.
+	 */
+
+	// m' = 0x59D9EBEB3F23782C3164971C4F61FE5CF893F8B602171C88E95EB7B0E1A988566D91A79575334CACB91DD2622FBD3D657
+	static const u64 M1[7] = {
+		0x91DD2622FBD3D657ULL,
+		0xD91A79575334CACBULL,
+		0x95EB7B0E1A988566ULL,
+		0x893F8B602171C88EULL,
+		0x164971C4F61FE5CFULL,
+		0x9D9EBEB3F23782C3ULL,
+		5 // replace multiplications by M1[6] with shift+add
+	};
+
+	// t <- m' * p >> (512 = 64*8)
+
+	// Comba multiplication: Right to left schoolbook column approach
+#define MUL_DIGIT_START(ii, jj) \
+	prod = u128_prod_sum(M1[ii], p[jj], u128_low(sum)); \
+	sum = u128_sum(u128_high(sum), u128_high(prod));
+
+#define MUL_DIGIT(ii, jj) \
+	prod = u128_prod_sum(M1[ii], p[jj], u128_low(prod)); \
+	u128_add(sum, u128_high(prod));
+
+	prod = u128_prod(M1[0], p[0]);
+
+	prod = u128_prod_sum(M1[1], p[0], u128_high(prod));
+	u128_set(sum, u128_high(prod));
+	MUL_DIGIT(0, 1);
+
+	MUL_DIGIT_START(2, 0);
+	MUL_DIGIT(1, 1);
+	MUL_DIGIT(0, 2);
+
+	MUL_DIGIT_START(3, 0);
+	MUL_DIGIT(2, 1);
+	MUL_DIGIT(1, 2);
+	MUL_DIGIT(0, 3);
+
+	MUL_DIGIT_START(4, 0);
+	MUL_DIGIT(3, 1);
+	MUL_DIGIT(2, 2);
+	MUL_DIGIT(1, 3);
+	MUL_DIGIT(0, 4);
+
+	MUL_DIGIT_START(5, 0);
+	MUL_DIGIT(4, 1);
+	MUL_DIGIT(3, 2);
+	MUL_DIGIT(2, 3);
+	MUL_DIGIT(1, 4);
+	MUL_DIGIT(0, 5);
+
+#undef MUL_DIGIT_START
+
+#define MUL_DIGIT_START(jj) \
+	prod = u128_lshift_sum(p[jj], 2, p[jj]); \
+	u128_add(prod, u128_low(sum)); \
+	sum = u128_sum(u128_high(sum), u128_high(prod));
+
+	MUL_DIGIT_START(0);
+	MUL_DIGIT(5, 1);
+	MUL_DIGIT(4, 2);
+	MUL_DIGIT(3, 3);
+	MUL_DIGIT(2, 4);
+	MUL_DIGIT(1, 5);
+	MUL_DIGIT(0, 6);
+
+	MUL_DIGIT_START(1);
+	MUL_DIGIT(5, 2);
+	MUL_DIGIT(4, 3);
+	MUL_DIGIT(3, 4);
+	MUL_DIGIT(2, 5);
+	MUL_DIGIT(1, 6);
+	MUL_DIGIT(0, 7);
+
+	MUL_DIGIT_START(2);
+	MUL_DIGIT(5, 3);
+	MUL_DIGIT(4, 4);
+	MUL_DIGIT(3, 5);
+	MUL_DIGIT(2, 6);
+	MUL_DIGIT(1, 7);
+
+	t[0] = u128_low(prod);
+
+	MUL_DIGIT_START(3);
+	MUL_DIGIT(5, 4);
+	MUL_DIGIT(4, 5);
+	MUL_DIGIT(3, 6);
+	MUL_DIGIT(2, 7);
+
+	t[1] = u128_low(prod);
+
+	MUL_DIGIT_START(4);
+	MUL_DIGIT(5, 5);
+	MUL_DIGIT(4, 6);
+	MUL_DIGIT(3, 7);
+
+	t[2] = u128_low(prod);
+
+	MUL_DIGIT_START(5);
+	MUL_DIGIT(5, 6);
+	MUL_DIGIT(4, 7);
+
+	t[3] = u128_low(prod);
+
+	MUL_DIGIT_START(6);
+	MUL_DIGIT(5, 7);
+
+	t[4] = u128_low(prod);
+
+	prod = u128_lshift_sum(p[7], 2, p[7]);
+	u128_add(prod, u128_low(sum));
+
+	t[5] = u128_low(prod);
+	t[6] = u128_high(prod) + u128_high(sum);
+
+#undef MUL_DIGIT_START
+#undef MUL_DIGIT
+
+	// n = p - t
+	sum = u128_diff(p[0], t[0]);
+	n[0] = u128_low(sum);
+	u128_borrow_add_sub(sum, p[1], t[1]);
+	n[1] = u128_low(sum);
+	u128_borrow_add_sub(sum, p[2], t[2]);
+	n[2] = u128_low(sum);
+	u128_borrow_add_sub(sum, p[3], t[3]);
+	n[3] = u128_low(sum);
+	u128_borrow_add_sub(sum, p[4], t[4]);
+	n[4] = u128_low(sum);
+	u128_borrow_add_sub(sum, p[5], t[5]);
+	n[5] = u128_low(sum);
+	u128_borrow_add_sub(sum, p[6], t[6]);
+	n[6] = u128_low(sum);
+	n[7] = u128_high(sum) + p[7];
+
+	// n >>= 1
+	n[0] = (n[0] >> 1) | (n[1] << 63);
+	n[1] = (n[1] >> 1) | (n[2] << 63);
+	n[2] = (n[2] >> 1) | (n[3] << 63);
+	n[3] = (n[3] >> 1) | (n[4] << 63);
+	n[4] = (n[4] >> 1) | (n[5] << 63);
+	n[5] = (n[5] >> 1) | (n[6] << 63);
+	n[6] = (n[6] >> 1) | (n[7] << 63);
+	n[7] >>= 1;
+
+	// n = (n + t) >> (251 = 64 * 3 + 59)
+	sum = u128_sum(n[0], t[0]);
+	u128_carry_add(sum, n[1], t[1]);
+	u128_carry_add(sum, n[2], t[2]);
+	u128_carry_add(sum, n[3], t[3]);
+	n[0] = u128_low(sum);
+	u128_carry_add(sum, n[4], t[4]);
+	n[1] = u128_low(sum);
+	u128_carry_add(sum, n[5], t[5]);
+	n[2] = u128_low(sum);
+	u128_carry_add(sum, n[6], t[6]);
+	n[3] = u128_low(sum);
+	n[4] = u128_high(sum) + n[7];
+
+	// n >>= 59 = p / q < 2^(512 - 251 = 261 bits)
+	n[0] = (n[0] >> 59) | (n[1] << 5);
+	n[1] = (n[1] >> 59) | (n[2] << 5);
+	n[2] = (n[2] >> 59) | (n[3] << 5);
+	n[3] = (n[3] >> 59) | (n[4] << 5);
+	//n[4] = n[4] >> 59;
+
+	// NOTE: n is now the quotient of p / q
+	// To recover the remainder, we need to multiply by q again:
+
+	// t = n * q (only need low 4 words of it)
+
+	// Comba multiplication: Right to left schoolbook column approach
+	prod = u128_prod(n[0], EC_Q[0]);
+
+	t[0] = u128_low(prod);
+
+	prod = u128_prod_sum(n[1], EC_Q[0], u128_high(prod));
+	u128_set(sum, u128_high(prod));
+	prod = u128_prod_sum(n[0], EC_Q[1], u128_low(prod));
+	u128_add(sum, u128_high(prod));
+
+	t[1] = u128_low(prod);
+
+	prod = u128_prod_sum(n[2], EC_Q[0], u128_low(sum));
+	u64 temp = u128_high(sum) + u128_high(prod);
+	prod = u128_prod_sum(n[1], EC_Q[1], u128_low(prod));
+	temp += u128_high(prod);
+	prod = u128_prod_sum(n[0], EC_Q[2], u128_low(prod));
+	temp += u128_high(prod);
+
+	t[2] = u128_low(prod);
+	t[3] = temp + n[3] * EC_Q[0] + n[2] * EC_Q[1] + n[1] * EC_Q[2] + n[0] * EC_Q[3];
+
+	// And then subtract it from the original input to get the remainder:
+
+	// r = p - t
+	sum = u128_diff(p[0], t[0]);
+	r[0] = u128_low(sum);
+	u128_borrow_add_sub(sum, p[1], t[1]);
+	r[1] = u128_low(sum);
+	u128_borrow_add_sub(sum, p[2], t[2]);
+	r[2] = u128_low(sum);
+	r[3] = u128_high(sum) + p[3] - t[3];
+}
+
 //// Test Driver
 
 bool ec_mul_gen_test() {
@@ -602,6 +920,68 @@ bool ec_mul_gen_test() {
 	return true;
 }
 
+bool ec_commit_test() {
+	u64 k[4], r[4];
+	ecpt_affine H, R1, R2;
+	u8 a1[64], a2[64];
+
+	H.x = EC_H.x;
+	H.y = EC_H.y;
+
+	vector<u32> t;
+
+	for (int jj = 0; jj < 10000; ++jj) {
+		random_k(k);
+		random_k(r);
+		ec_mask_scalar(k);
+		ec_mask_scalar(r);
+
+		// Zero scalars are computed by the reference as q
+		if (jj == 0) {
+			memcpy(k, EC_Q, sizeof(k));
+		} else if (jj == 1) {
+			memcpy(r, EC_Q, sizeof(r));
+		}
+
+		ec_simul_ref(k, EC_G_AFFINE, r, H, R1);
+
+		if (jj == 0) {
+			memset(k, 0, sizeof(k));
+		} else if (jj == 1) {
+			memset(r, 0, sizeof(r));
+		}
+
+		u32 t0 = Clock::cycles();
+
+		ecpt p;
+		ufe p2b;
+		ec_commit(k, r, p, p2b);
+		ec_affine(p, R2);
+
+		u32 t1 = Clock::cycles();
+
+		t.push_back(t1 - t0);
+
+		// Reference result is multiplied by 4
+		ec_dbl(p, p, false, p2b);
+		ec_dbl(p, p, false, p2b);
+		ec_affine(p, R2);
+
+		ec_save_xy(R1, a1);
+		ec_save_xy(R2, a2);
+
+		if (0 != memcmp(a1, a2, 64)) {
+			return false;
+		}
+	}
+
+	u32 median = quick_select(&t[0], (int)t.size());
+
+	cout << "+ ec_commit: `" << dec << median << "` median cycles" << endl;
+
+	return true;
+}
+
 bool ec_mul_test(const ecpt_affine &BP) {
 	u64 k[4];
 	ecpt_affine R1, R2;
@@ -752,6 +1132,61 @@ bool ec_simul_gen_test(const ecpt_affine &BP) {
 	return true;
 }
 
+bool ec_simul_prep_test(const ecpt_affine &B1, const ecpt_affine &B2) {
+	u64 k1[4] = {0};
+	u64 k2[4] = {0};
+	ecpt_affine R1, R2;
+	u8 a1[64], a2[64];
+
+	vector<u32> t;
+	double wall = 0;
+
+	ecpt_prep prep;
+	ec_prepare(B2, prep);
+
+	for (int jj = 0; jj < 10000; ++jj) {
+		random_k(k1);
+		random_k(k2);
+		ec_mask_scalar(k1);
+		ec_mask_scalar(k2);
+
+		ec_simul_ref(k1, B1, k2, B2, R1);
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		ecpt p;
+		ufe t2b;
+		ec_expand(B1, p);
+		ec_simul_prep(k1, p, true, k2, prep, p, t2b);
+		ec_dbl(p, p, false, t2b);
+		ec_dbl(p, p, false, t2b);
+		ec_affine(p, R2);
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		t.push_back(t1 - t0);
+		wall += s1 - s0;
+
+		ec_save_xy(R1, a1);
+		ec_save_xy(R2, a2);
+
+		for (int ii = 0; ii < 64; ++ii) {
+			if (a1[ii] != a2[ii]) {
+				return false;
+			}
+		}
+	}
+
+	u32 median = quick_select(&t[0], (int)t.size());
+	wall /= t.size();
+
+	cout << "+ ec_simul_prep: `" << dec << median << "` median cycles, `" << wall << "` avg usec" << endl;
+
+	return true;
+}
+
 bool mod_q_test() {
 	u64 x[8], r[4];
 
@@ -851,6 +1286,135 @@ bool mul_mod_q_test() {
 	return true;
 }
 
+// Random 512-bit input, with some inputs made close to multiples of q
+static void random_mod_q_input(int jj, u64 p[8]) {
+	random_k(p);
+	random_k(p + 4);
+
+	switch (jj % 8) {
+	case 0: // Product of two scalars: < 2^508
+		p[7] &= 0x0FFFFFFFFFFFFFFFULL;
+		break;
+	case 1: // Sum of two scalars: < 2^257
+		p[4] &= 1;
+		p[5] = p[6] = p[7] = 0;
+		break;
+	case 2: { // k * q + small
+		u64 k[4];
+		random_k(k);
+		mul_ref_product(k, EC_Q, p);
+		u128 sum = u128_sum(p[0], (u64)(jj & 7));
+		p[0] = u128_low(sum);
+		for (int ii = 1; ii < 8; ++ii) {
+			u128_carry_add(sum, p[ii]);
+			p[ii] = u128_low(sum);
+		}
+		break;
+	}
+	case 3: // All bits set in the low words
+		p[0] = p[1] = p[2] = ~(u64)0;
+		p[3] = 0x0FFFFFFFFFFFFFFFULL;
+		break;
+	default:
+		break;
+	}
+}
+
+// Differential test of mod_q, mul_mod_q and add_mod_q against mod_q_ref
+bool mod_q_diff_test() {
+	u64 p[8], r1[4], r2[4];
+
+	// Exact multiples of q and neighbors
+	static const u64 EDGES[][8] = {
+		{ 0, 0, 0, 0, 0, 0, 0, 0 },
+		{ 1, 0, 0, 0, 0, 0, 0, 0 },
+		{ 0xCE9B68E3B09E01A4ULL, 0xA6261414C0DC87D3ULL, ~0ULL, 0x0FFFFFFFFFFFFFFFULL, 0, 0, 0, 0 },
+		{ 0xCE9B68E3B09E01A5ULL, 0xA6261414C0DC87D3ULL, ~0ULL, 0x0FFFFFFFFFFFFFFFULL, 0, 0, 0, 0 },
+		{ 0xCE9B68E3B09E01A6ULL, 0xA6261414C0DC87D3ULL, ~0ULL, 0x0FFFFFFFFFFFFFFFULL, 0, 0, 0, 0 },
+		{ 0, 0, 0, 0x1000000000000000ULL, 0, 0, 0, 0 },
+		{ ~0ULL, ~0ULL, ~0ULL, ~0ULL, 0, 0, 0, 0 },
+		{ ~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL, ~0ULL },
+	};
+
+	for (int ii = 0; ii < (int)(sizeof(EDGES) / sizeof(EDGES[0])); ++ii) {
+		mod_q(EDGES[ii], r1);
+		mod_q_ref(EDGES[ii], r2);
+		if (memcmp(r1, r2, sizeof(r1)) != 0) {
+			return false;
+		}
+	}
+
+	vector<u32> t1, t2;
+
+	for (int jj = 0; jj < 100000; ++jj) {
+		random_mod_q_input(jj, p);
+
+		u32 c0 = Clock::cycles();
+		mod_q(p, r1);
+		u32 c1 = Clock::cycles();
+		mod_q_ref(p, r2);
+		u32 c2 = Clock::cycles();
+
+		t1.push_back(c1 - c0);
+		t2.push_back(c2 - c1);
+
+		if (memcmp(r1, r2, sizeof(r1)) != 0) {
+			return false;
+		}
+
+		// In-place use as in snowshoe_mod_q()
+		memcpy(r2, p, sizeof(r2));
+		mod_q(p, p);
+		if (memcmp(p, r1, sizeof(r1)) != 0) {
+			return false;
+		}
+		memcpy(p, r2, sizeof(r2));
+
+		// x * y + z and x + y, including operands up to 2^256
+		u64 x[4], y[4], z[4], w[8];
+		random_k(x);
+		random_k(y);
+		random_k(z);
+		if (jj & 1) {
+			ec_mask_scalar(y);
+		}
+
+		mul_mod_q(x, y, z, r1);
+		mul_ref_product(x, y, w);
+		u128 sum = u128_sum(w[0], z[0]);
+		w[0] = u128_low(sum);
+		for (int ii = 1; ii < 8; ++ii) {
+			u128_carry_add(sum, w[ii], ii < 4 ? z[ii] : 0);
+			w[ii] = u128_low(sum);
+		}
+		mod_q_ref(w, r2);
+		if (memcmp(r1, r2, sizeof(r1)) != 0) {
+			return false;
+		}
+
+		add_mod_q(x, y, r1);
+		memset(w, 0, sizeof(w));
+		sum = u128_sum(x[0], y[0]);
+		w[0] = u128_low(sum);
+		for (int ii = 1; ii < 4; ++ii) {
+			u128_carry_add(sum, x[ii], y[ii]);
+			w[ii] = u128_low(sum);
+		}
+		w[4] = u128_high(sum);
+		mod_q_ref(w, r2);
+		if (memcmp(r1, r2, sizeof(r1)) != 0) {
+			return false;
+		}
+	}
+
+	u32 m1 = quick_select(&t1[0], (int)t1.size());
+	u32 m2 = quick_select(&t2[0], (int)t2.size());
+
+	cout << "+ mod_q: `" << dec << m1 << "` median cycles (division-based: `" << m2 << "`)" << endl;
+
+	return true;
+}
+
 static bool ec_elligator_test() {
 	ecpt_affine r;
 
@@ -887,6 +1451,181 @@ static bool ec_elligator_test() {
 }
 
 
+static bool ec_elligator_batch_test() {
+	ecpt_affine r[EC_ELLIGATOR_BATCH], r1;
+	u8 a1[64], a2[64];
+
+	vector<u32> t;
+	double wall = 0;
+
+	for (int ii = 0; ii < 1000; ++ii) {
+		char n[32 * EC_ELLIGATOR_BATCH] = {0};
+		for (int jj = 0; jj < EC_ELLIGATOR_BATCH; ++jj) {
+			random_k((u64*)(n + jj * 32));
+		}
+
+		// Exercise the zero input in one of the lanes
+		if (ii == 0) {
+			memset(n + 5 * 32, 0, 32);
+		}
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		ec_elligator_decode_batch(n, EC_ELLIGATOR_BATCH, r);
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		t.push_back((t1 - t0) / EC_ELLIGATOR_BATCH);
+		wall += (s1 - s0) / EC_ELLIGATOR_BATCH;
+
+		for (int jj = 0; jj < EC_ELLIGATOR_BATCH; ++jj) {
+			ec_elligator_decode(n + jj * 32, r1);
+
+			ec_save_xy(r1, a1);
+			ec_save_xy(r[jj], a2);
+
+			for (int kk = 0; kk < 64; ++kk) {
+				if (a1[kk] != a2[kk]) {
+					cout << "elligator batch mismatch ii = " << ii << " jj = " << jj << endl;
+					return false;
+				}
+			}
+		}
+	}
+
+	u32 median = quick_select(&t[0], (int)t.size());
+	wall /= t.size();
+
+	cout << "+ ec_elligator_batch: `" << dec << median << "` median cycles, `" << wall << "` avg usec per point" << endl;
+
+	return true;
+}
+
+static bool ec_elligator_proj_test() {
+	ecpt_affine r1, r2;
+	u8 a1[64], a2[64];
+
+	vector<u32> t;
+	double wall = 0;
+
+	for (int ii = 0; ii < 10000; ++ii) {
+		char n[32] = {0};
+		random_k((u64*)n);
+
+		ecpt p;
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		ec_elligator_decode_proj(n, p);
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		t.push_back(t1 - t0);
+		wall += s1 - s0;
+
+		ec_elligator_decode(n, r1);
+		ec_affine(p, r2);
+
+		ec_save_xy(r1, a1);
+		ec_save_xy(r2, a2);
+
+		for (int jj = 0; jj < 64; ++jj) {
+			if (a1[jj] != a2[jj]) {
+				cout << "elligator proj mismatch ii = " << ii << endl;
+				return false;
+			}
+		}
+
+		// Check T = XY/Z
+		ufe xy, zt;
+		fe_mul(p.x, p.y, xy);
+		fe_mul(p.z, p.t, zt);
+		fe_complete_reduce(xy);
+		fe_complete_reduce(zt);
+		if (!fe_isequal_vartime(xy, zt)) {
+			cout << "elligator proj T mismatch ii = " << ii << endl;
+			return false;
+		}
+	}
+
+	u32 median = quick_select(&t[0], (int)t.size());
+	wall /= t.size();
+
+	cout << "+ ec_elligator_proj: `" << dec << median << "` median cycles, `" << wall << "` avg usec" << endl;
+
+	return true;
+}
+
+static bool ec_elligator_encode_test() {
+	ecpt_affine p, r;
+	u8 a1[64], a2[64];
+	int found = 0;
+
+	vector<u32> t;
+	double wall = 0;
+
+	for (int ii = 0; ii < 10000; ++ii) {
+		u64 k[4];
+		random_k(k);
+		ec_mask_scalar(k);
+
+		ecpt P;
+		ufe t2b;
+		ec_mul_gen(k, P, t2b);
+		ec_affine(P, p);
+
+		u64 noise[4];
+		random_k(noise);
+
+		char n[32];
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		bool success = ec_elligator_encode(p, (u32)noise[0], n);
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		t.push_back(t1 - t0);
+		wall += s1 - s0;
+
+		if (!success) {
+			continue;
+		}
+		++found;
+
+		ec_elligator_decode(n, r);
+
+		ec_save_xy(p, a1);
+		ec_save_xy(r, a2);
+
+		for (int jj = 0; jj < 64; ++jj) {
+			if (a1[jj] != a2[jj]) {
+				cout << "elligator encode round trip fails ii = " << ii << endl;
+				return false;
+			}
+		}
+	}
+
+	// About half of the points should have a representative
+	if (found < 4000 || found > 6000) {
+		cout << "elligator encode found " << found << " representatives" << endl;
+		return false;
+	}
+
+	u32 median = quick_select(&t[0], (int)t.size());
+	wall /= t.size();
+
+	cout << "+ ec_elligator_encode: `" << dec << median << "` median cycles, `" << wall << "` avg usec" << endl;
+
+	return true;
+}
+
 //// Entrypoint
 
 static void tscTime() {
@@ -920,9 +1659,13 @@ int main() {
 
 	// Verify tables have not been tampered with
 	assert(ec_gen_tables3_comb_test());
-	assert(ec_gen_tables_comb_test());
+	assert(ec_gen_tables_comb_test(EC_G, GEN_TABLE, GEN_FIX));
+	assert(ec_gen_h_test());
+	assert(ec_gen_tables_comb_test(EC_H, H_TABLE, H_FIX));
+	assert(ec_precomp_alignment_test());
 
 	assert(mod_q_test());
+	assert(mod_q_diff_test());
 
 	assert(mul_mod_q_test());
 	assert(add_mod_q_test());
@@ -951,16 +1694,22 @@ int main() {
 	ec_mul_ref(bk2, EC_G_AFFINE, bp2);
 
 	assert(ec_elligator_test());
+	assert(ec_elligator_batch_test());
+	assert(ec_elligator_encode_test());
+	assert(ec_elligator_proj_test());
 	assert(ec_mul_gen_test());
+	assert(ec_commit_test());
 	assert(ec_mul_test(bp1));
 	assert(ec_simul_gen_test(bp1));
 	assert(ec_simul_test(bp1, bp2));
+	assert(ec_simul_prep_test(bp1, bp2));
 
 	cout << "Extra tests with exceptional points:" << endl;
 
 	// Extra tests:
 	assert(ec_simul_test(bp2, EC_O_AFFINE));
 	assert(ec_simul_test(EC_O_AFFINE, bp1));
+	assert(ec_simul_prep_test(bp2, EC_O_AFFINE));
 	assert(ec_mul_test(bp2));
 	assert(ec_mul_test(EC_O_AFFINE));
 	assert(ec_simul_gen_test(EC_O_AFFINE));
@@ -505,6 +505,47 @@ bool fp_sqrt_test(const ufp &a) {
 	return fp_isequal_test(a1, a);
 }
 
+bool fp_inv_vartime_test(const ufp &a) {
+	ufp x, y;
+
+	fp_set(a, x);
+	fp_inv(x, y);
+	fp_inv_vartime(x, x);
+
+	fp_complete_reduce(x);
+	fp_complete_reduce(y);
+
+	return fp_isequal_test(x, y);
+}
+
+// Compare against fp_inv for pseudo-random inputs of every bit length
+bool fp_inv_vartime_random_test() {
+	ufp a;
+	u64 s = 0x243f6a8885a308d3ULL;
+
+	for (int ii = 0; ii < 100000; ++ii) {
+		s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+		a.i[0] = s;
+		s ^= s << 13; s ^= s >> 7; s ^= s << 17;
+		a.i[1] = s & 0x7fffffffffffffffULL;
+
+		// Shorten the input to exercise the single-word loop
+		const int bits = ii % 127;
+		if (bits < 64) {
+			a.i[0] &= ((u64)1 << bits) | (((u64)1 << bits) - 1);
+			a.i[1] = 0;
+		} else {
+			a.i[1] &= ((u64)1 << (bits - 64)) | (((u64)1 << (bits - 64)) - 1);
+		}
+
+		if (!fp_inv_vartime_test(a)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 
 //// Entrypoint
 
@@ -651,6 +692,21 @@ int main() {
 	assert(fp_exp_test(C0, C2, C0));
 	assert(fp_exp_test(CR1, CR2, CX3));
 
+	// fp_inv_vartime <-> fp_inv:
+	assert(fp_inv_vartime_test(C0));
+	assert(fp_inv_vartime_test(C1));
+	assert(fp_inv_vartime_test(C2));
+	assert(fp_inv_vartime_test(C0F));
+	assert(fp_inv_vartime_test(C64));
+	assert(fp_inv_vartime_test(C65));
+	assert(fp_inv_vartime_test(CN1));
+	assert(fp_inv_vartime_test(CN2));
+	assert(fp_inv_vartime_test(CP));
+	assert(fp_inv_vartime_test(CR1));
+	assert(fp_inv_vartime_test(CR2));
+	assert(fp_inv_vartime_test(CX3));
+	assert(fp_inv_vartime_random_test());
+
 	// fp_inv <-> fp_mul, fp_sqr:
 	assert(fp_exp_inv_test(C1));
 	assert(fp_exp_inv_test(C2));
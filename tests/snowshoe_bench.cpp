@@ -0,0 +1,1253 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <set>
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "Clock.hpp"
+using namespace cat;
+
+static Clock m_clock;
+
+// Whole library, so that internal routines can be measured too
+#include "../src/snowshoe.cpp"
+
+
+// Keeps results live so the compiler does not remove the work
+static volatile u64 m_sink;
+
+static void sink(const void *data, int bytes) {
+	const u8 *p = (const u8 *)data;
+	u64 x = 0;
+	for (int ii = 0; ii < bytes; ii += 8) {
+		x += p[ii];
+	}
+	m_sink += x;
+}
+
+
+//// Hardware Counters
+
+enum {
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_BRANCH_MISSES,
+	PERF_L1D_MISSES,
+	PERF_LLC_MISSES,
+	PERF_DTLB_MISSES,
+	PERF_COUNT
+};
+
+// Group of counters led by the cycle counter
+static int m_perf_fd[PERF_COUNT] = { -1, -1, -1, -1, -1, -1 };
+static bool m_perf = false;
+
+// Core cycles per RDTSC tick, for when perf_event is not available
+static double m_tsc_ratio = 1;
+
+#ifdef __linux__
+
+static int perf_open(u32 type, u64 config, int group) {
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = group < 0 ? 1 : 0;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+
+	return (int)syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static u64 perf_cache(u64 cache, u64 op, u64 result) {
+	return cache | (op << 8) | (result << 16);
+}
+
+// Returns false if the cycle counter cannot be opened
+static bool perf_init() {
+	m_perf_fd[PERF_CYCLES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+	if (m_perf_fd[PERF_CYCLES] < 0) {
+		return false;
+	}
+
+	const int group = m_perf_fd[PERF_CYCLES];
+
+	// The rest are optional, since many VMs and older cores lack some of them
+	m_perf_fd[PERF_INSTRUCTIONS] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, group);
+	m_perf_fd[PERF_BRANCH_MISSES] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, group);
+	m_perf_fd[PERF_L1D_MISSES] = perf_open(PERF_TYPE_HW_CACHE, perf_cache(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), group);
+	m_perf_fd[PERF_LLC_MISSES] = perf_open(PERF_TYPE_HW_CACHE, perf_cache(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), group);
+	m_perf_fd[PERF_DTLB_MISSES] = perf_open(PERF_TYPE_HW_CACHE, perf_cache(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS), group);
+
+	return true;
+}
+
+static void perf_shutdown() {
+	for (int ii = 0; ii < PERF_COUNT; ++ii) {
+		if (m_perf_fd[ii] >= 0) {
+			close(m_perf_fd[ii]);
+			m_perf_fd[ii] = -1;
+		}
+	}
+}
+
+static void perf_start() {
+	ioctl(m_perf_fd[PERF_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(m_perf_fd[PERF_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+// Stop counting and read the group, leaving missing counters at zero
+static bool perf_stop(u64 values[PERF_COUNT]) {
+	ioctl(m_perf_fd[PERF_CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+	// { nr, { value, id } * nr }
+	u64 data[1 + 2 * PERF_COUNT];
+	if (read(m_perf_fd[PERF_CYCLES], data, sizeof(data)) < (ssize_t)sizeof(u64)) {
+		return false;
+	}
+
+	for (int ii = 0; ii < PERF_COUNT; ++ii) {
+		values[ii] = 0;
+	}
+
+	for (u64 jj = 0; jj < data[0] && jj < PERF_COUNT; ++jj) {
+		const u64 value = data[1 + jj * 2], id = data[2 + jj * 2];
+
+		for (int ii = 0; ii < PERF_COUNT; ++ii) {
+			u64 fd_id;
+			if (m_perf_fd[ii] >= 0 && ioctl(m_perf_fd[ii], PERF_EVENT_IOC_ID, &fd_id) == 0 && fd_id == id) {
+				values[ii] = value;
+			}
+		}
+	}
+
+	return true;
+}
+
+#else
+
+static bool perf_init() {
+	return false;
+}
+
+static void perf_shutdown() {
+}
+
+static void perf_start() {
+}
+
+static bool perf_stop(u64 values[PERF_COUNT]) {
+	(void)values;
+	return false;
+}
+
+#endif // __linux__
+
+// Measure core cycles per RDTSC tick with a chain of dependent adds
+static void tscCalibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+	const int iterations = 10000000;
+	double best = 0;
+
+	for (int trial = 0; trial < 5; ++trial) {
+		u32 x = 0;
+		const u32 c0 = Clock::cycles();
+
+		// Eight adds per loop, each waiting on the last, so one per cycle
+		for (int ii = 0; ii < iterations; ++ii) {
+			__asm__ __volatile__ (
+				"add $1, %0\n\tadd $1, %0\n\tadd $1, %0\n\tadd $1, %0\n\t"
+				"add $1, %0\n\tadd $1, %0\n\tadd $1, %0\n\tadd $1, %0"
+				: "+r" (x));
+		}
+
+		const u32 c1 = Clock::cycles();
+		sink(&x, sizeof(x));
+
+		// Keep the fastest trial, which was least disturbed
+		const double ratio = iterations * 8.0 / (u32)(c1 - c0);
+		if (ratio > best) {
+			best = ratio;
+		}
+	}
+
+	m_tsc_ratio = best;
+#endif
+}
+
+
+//// Benchmark Driver
+
+/*
+ * Each benchmark is a function that performs `items` operations.  It is
+ * run a few times to warm up, then sampled until it has enough samples or
+ * its time budget runs out.  Results are reported per operation.
+ *
+ * Options:
+ *	--json FILE       Write results as JSON
+ *	--baseline FILE   Compare against JSON from an earlier run
+ *	--threshold PCT   Flag median regressions above PCT percent (default 5)
+ *	--filter TEXT     Only run benchmarks whose name contains TEXT
+ *	--samples N       Samples per benchmark (default 200)
+ *	--cpu N           Pin to CPU N (default 0, Linux only, -1 to disable)
+ *	--no-perf         Do not use hardware performance counters
+ *
+ * Scaling mode replaces the latency benchmarks:
+ *	--scaling SECONDS Run the operation mix on 1..N pinned threads for
+ *	                  SECONDS at each step and report throughput
+ *	--threads N       Largest number of threads (default all CPUs)
+ *	--mix LIST        Weighted operations, e.g. mul_gen=2,dh_server=1
+ *	                  (default equal parts of every operation)
+ *
+ * Cycles are core clock cycles.  On Linux they are read from perf_event
+ * along with instructions, branch misses, L1D, LLC and dTLB misses, all
+ * counted in user mode only.  Where perf_event is not available, RDTSC is
+ * scaled by the ratio of core clock to TSC, measured by timing a chain of
+ * dependent adds that runs at one per cycle.  Either way the results do
+ * not depend on Turbo Boost being disabled.
+ *
+ * In a build with CAT_SNOWSHOE_COUNT_OPS defined, each benchmark is run
+ * once more between snowshoe_counts_snapshot() calls to print the M/S/A/I
+ * breakdown per operation.  Timings from that build are not meaningful.
+ *
+ * Exits with 2 if any regression was flagged.
+ */
+
+struct BenchResult {
+	string name;
+	int batch;
+	double median_cycles, p99_cycles, mean_cycles;
+	double median_ns;
+
+	// Hardware counters per item, if perf_event is available
+	bool perf;
+	double ipc, branch_misses, l1d_misses, llc_misses, dtlb_misses;
+
+	// Operation counts per item, if counting is built in
+	bool counted;
+	snowshoe_counts counts;
+	double items;
+};
+
+static vector<BenchResult> m_results;
+static string m_filter;
+static int m_samples = 200;
+static double m_ghz = 1;
+
+static double percentile(vector<double> &v, double p) {
+	const size_t k = (size_t)(p * (v.size() - 1) + 0.5);
+	nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+static void bench(const string &name, int batch, int items, const function<void()> &fn) {
+	if (!m_filter.empty() && name.find(m_filter) == string::npos) {
+		return;
+	}
+
+	// Warm up caches and branch predictors
+	for (int ii = 0; ii < 5; ++ii) {
+		fn();
+	}
+
+	vector<double> cycles, ns, counters[PERF_COUNT];
+	const double t_end = m_clock.usec() + 500000.0;
+
+	for (int ii = 0; ii < m_samples; ++ii) {
+		u64 values[PERF_COUNT];
+
+		if (m_perf) {
+			perf_start();
+		}
+
+		const auto n0 = chrono::steady_clock::now();
+		const u32 c0 = Clock::cycles();
+
+		fn();
+
+		const u32 c1 = Clock::cycles();
+		const auto n1 = chrono::steady_clock::now();
+
+		if (m_perf && perf_stop(values)) {
+			for (int jj = 0; jj < PERF_COUNT; ++jj) {
+				counters[jj].push_back((double)values[jj] / items);
+			}
+			cycles.push_back((double)values[PERF_CYCLES] / items);
+		} else {
+			cycles.push_back((double)(u32)(c1 - c0) * m_tsc_ratio / items);
+		}
+		ns.push_back(chrono::duration<double, nano>(n1 - n0).count() / items);
+
+		if (ii >= 10 && m_clock.usec() > t_end) {
+			break;
+		}
+	}
+
+	BenchResult r;
+	r.name = name;
+	r.batch = batch;
+	r.mean_cycles = 0;
+	for (size_t ii = 0; ii < cycles.size(); ++ii) {
+		r.mean_cycles += cycles[ii];
+	}
+	r.mean_cycles /= cycles.size();
+	r.p99_cycles = percentile(cycles, 0.99);
+	r.median_cycles = percentile(cycles, 0.5);
+	r.median_ns = percentile(ns, 0.5);
+
+	r.perf = !counters[PERF_CYCLES].empty();
+	if (r.perf) {
+		const double instructions = percentile(counters[PERF_INSTRUCTIONS], 0.5);
+		r.ipc = r.median_cycles > 0 ? instructions / r.median_cycles : 0;
+		r.branch_misses = percentile(counters[PERF_BRANCH_MISSES], 0.5);
+		r.l1d_misses = percentile(counters[PERF_L1D_MISSES], 0.5);
+		r.llc_misses = percentile(counters[PERF_LLC_MISSES], 0.5);
+		r.dtlb_misses = percentile(counters[PERF_DTLB_MISSES], 0.5);
+	}
+
+	cout << left << setw(40) << name << right << setw(6) << batch
+		<< fixed << setprecision(1)
+		<< setw(14) << r.median_cycles << setw(14) << r.p99_cycles
+		<< setw(14) << r.mean_cycles << setw(14) << r.median_ns;
+
+	if (r.perf) {
+		cout << setprecision(2) << setw(8) << r.ipc
+			<< setprecision(1) << setw(10) << r.branch_misses << setw(10) << r.l1d_misses
+			<< setw(10) << r.llc_misses << setw(10) << r.dtlb_misses;
+	}
+	cout << endl;
+
+	// Count operations for one more run
+	snowshoe_counts c0, c1;
+	r.items = items;
+	r.counted = 0 == snowshoe_counts_snapshot(&c0);
+	if (r.counted) {
+		fn();
+		snowshoe_counts_snapshot(&c1);
+
+		const unsigned long long *a = (const unsigned long long *)&c0;
+		const unsigned long long *b = (const unsigned long long *)&c1;
+		unsigned long long *d = (unsigned long long *)&r.counts;
+		for (size_t ii = 0; ii < sizeof(snowshoe_counts) / sizeof(*d); ++ii) {
+			d[ii] = b[ii] - a[ii];
+		}
+
+		const snowshoe_counts &n = r.counts;
+		cout << setprecision(1)
+			<< "    Fp^2: " << n.fe_mul / r.items << "M " << n.fe_sqr / r.items << "S "
+			<< n.fe_add / r.items << "A " << n.fe_mul_u / r.items << "U "
+			<< n.fe_mul_smallk / r.items << "D " << n.fe_inv / r.items << "I "
+			<< n.fe_sqrt / r.items << "sqrt " << n.fe_chi / r.items << "chi"
+			<< "  Fp: " << n.fp_mul / r.items << "M " << n.fp_sqr / r.items << "S "
+			<< n.fp_add / r.items << "A " << n.fp_mul_smallk / r.items << "D "
+			<< n.fp_inv / r.items << "I " << n.fp_sqrt / r.items << "sqrt "
+			<< n.fp_chi / r.items << "chi"
+			<< "  " << n.table_select / r.items << " lookups "
+			<< n.ec_add / r.items << " adds " << n.ec_dbl / r.items << " dbls" << endl;
+	}
+
+	m_results.push_back(r);
+}
+
+static void tscTime() {
+	const u32 c0 = Clock::cycles();
+	const double t0 = m_clock.usec();
+	const double t_end = t0 + 200000.0;
+
+	double t;
+	u32 c;
+	do {
+		c = Clock::cycles();
+		t = m_clock.usec();
+	} while (t < t_end);
+
+	m_ghz = (c - c0) / (t - t0) / 1000.0;
+}
+
+static void pin_cpu(int cpu) {
+#ifdef __linux__
+	if (cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+
+		if (sched_setaffinity(0, sizeof(set), &set)) {
+			cout << "Unable to pin to CPU " << cpu << endl;
+		}
+	}
+#else
+	(void)cpu;
+#endif
+}
+
+
+//// JSON
+
+// One result per line, so the baseline can be read back line by line
+static bool write_json(const string &path) {
+	ofstream f(path.c_str());
+	if (!f) {
+		return false;
+	}
+
+	f << "{\n\t\"rdtsc_ghz\": " << m_ghz
+		<< ",\n\t\"cycle_source\": \"" << (m_perf ? "perf_event" : "rdtsc") << "\""
+		<< ",\n\t\"tsc_ratio\": " << m_tsc_ratio << ",\n\t\"results\": [\n";
+
+	for (size_t ii = 0; ii < m_results.size(); ++ii) {
+		const BenchResult &r = m_results[ii];
+
+		f << "\t\t{\"name\": \"" << r.name << "\", \"batch\": " << r.batch
+			<< ", \"median_cycles\": " << r.median_cycles
+			<< ", \"p99_cycles\": " << r.p99_cycles
+			<< ", \"mean_cycles\": " << r.mean_cycles
+			<< ", \"median_ns\": " << r.median_ns;
+
+		if (r.perf) {
+			f << ", \"ipc\": " << r.ipc
+				<< ", \"branch_misses\": " << r.branch_misses
+				<< ", \"l1d_misses\": " << r.l1d_misses
+				<< ", \"llc_misses\": " << r.llc_misses
+				<< ", \"dtlb_misses\": " << r.dtlb_misses;
+		}
+
+		if (r.counted) {
+			const snowshoe_counts &n = r.counts;
+
+			f << ", \"fe_mul\": " << n.fe_mul / r.items
+				<< ", \"fe_sqr\": " << n.fe_sqr / r.items
+				<< ", \"fe_add\": " << n.fe_add / r.items
+				<< ", \"fe_inv\": " << n.fe_inv / r.items
+				<< ", \"fp_mul\": " << n.fp_mul / r.items
+				<< ", \"fp_sqr\": " << n.fp_sqr / r.items
+				<< ", \"fp_add\": " << n.fp_add / r.items
+				<< ", \"fp_inv\": " << n.fp_inv / r.items
+				<< ", \"ec_add\": " << n.ec_add / r.items
+				<< ", \"ec_dbl\": " << n.ec_dbl / r.items;
+		}
+
+		f << "}"
+			<< (ii + 1 < m_results.size() ? "," : "") << "\n";
+	}
+
+	f << "\t]\n}\n";
+
+	return true;
+}
+
+// Returns the number of regressions, or -1 if the baseline is unreadable
+static int compare_baseline(const string &path, double threshold) {
+	ifstream f(path.c_str());
+	if (!f) {
+		return -1;
+	}
+
+	int regressions = 0;
+	string line;
+
+	cout << endl << "Baseline comparison (" << path << ", threshold " << threshold << "%)" << endl;
+
+	while (getline(f, line)) {
+		const size_t pn = line.find("\"name\": \"");
+		const size_t pb = line.find("\"batch\": ");
+		const size_t pm = line.find("\"median_cycles\": ");
+		if (pn == string::npos || pb == string::npos || pm == string::npos) {
+			continue;
+		}
+
+		const size_t name_start = pn + 9;
+		const string name = line.substr(name_start, line.find('"', name_start) - name_start);
+		const int batch = atoi(line.c_str() + pb + 9);
+		const double base = atof(line.c_str() + pm + 17);
+
+		for (size_t ii = 0; ii < m_results.size(); ++ii) {
+			const BenchResult &r = m_results[ii];
+
+			if (r.name != name || r.batch != batch || base <= 0) {
+				continue;
+			}
+
+			const double change = (r.median_cycles / base - 1.0) * 100.0;
+
+			if (change > threshold) {
+				cout << "REGRESSION " << left << setw(40) << name << right << setw(6) << batch
+					<< fixed << setprecision(1) << setw(14) << base << " -> " << r.median_cycles
+					<< " (+" << change << "%)" << endl;
+				++regressions;
+			}
+		}
+	}
+
+	cout << regressions << " regressions" << endl;
+
+	return regressions;
+}
+
+
+//// Inputs
+
+static void random_bytes(void *data, int bytes) {
+	u8 *p = (u8 *)data;
+	for (int ii = 0; ii < bytes; ++ii) {
+		p[ii] = (u8)(rand() >> 3);
+	}
+}
+
+static void random_key(char k[32]) {
+	random_bytes(k, 32);
+	snowshoe_secret_gen(k);
+}
+
+// Same as above from a per-thread engine, for inputs set up on worker threads
+static void random_bytes(mt19937_64 &rng, void *data, int bytes) {
+	u8 *p = (u8 *)data;
+	for (int ii = 0; ii < bytes; ++ii) {
+		p[ii] = (u8)rng();
+	}
+}
+
+static void random_key(mt19937_64 &rng, char k[32]) {
+	random_bytes(rng, k, 32);
+	snowshoe_secret_gen(k);
+}
+
+static void random_fp(ufp &a) {
+	random_bytes(&a, sizeof(a));
+	a.i[1] &= 0x7FFFFFFFFFFFFFFFULL;
+}
+
+static void random_fe(ufe &a) {
+	random_fp(a.a);
+	random_fp(a.b);
+}
+
+
+//// Benchmarks
+
+static const int PRIM_REPS = 1000;
+static const int SLOW_REPS = 10;
+
+static void bench_field() {
+	ufp a, b;
+	ufe x, y;
+	random_fp(a);
+	random_fp(b);
+	random_fe(x);
+	random_fe(y);
+
+	bench("fp_add", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) fp_add(a, b, a); });
+	bench("fp_sub", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) fp_sub(a, b, a); });
+	bench("fp_mul", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) fp_mul(a, b, a); });
+	bench("fp_sqr", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) fp_sqr(a, a); });
+	bench("fp_inv", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) fp_inv(a, a); });
+	bench("fp_inv_vartime", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) fp_inv_vartime(a, a); });
+	bench("fp_sqrt", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) fp_sqrt(a, a); });
+	bench("fp_chi", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) a.i[0] += fp_chi(a); });
+
+	bench("fe_add", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) fe_add(x, y, x); });
+	bench("fe_sub", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) fe_sub(x, y, x); });
+	bench("fe_mul", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) fe_mul(x, y, x); });
+	bench("fe_sqr", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) fe_sqr(x, x); });
+	bench("fe_inv", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) fe_inv(x, x); });
+	bench("fe_inv_vartime", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) fe_inv_vartime(x, x); });
+	bench("fe_sqrt", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) fe_sqrt(x, x, false); });
+	bench("fe_chi", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) x.a.i[0] += fe_chi(x); });
+
+	sink(&a, sizeof(a));
+	sink(&x, sizeof(x));
+
+	for (int n = 1; n <= 64; n *= 4) {
+		vector<ufp> v(n), scratch(n);
+		for (int ii = 0; ii < n; ++ii) {
+			random_fp(v[ii]);
+		}
+
+		bench("fp_inv_batch", n, n, [&] { fp_inv_batch(&v[0], &scratch[0], n); });
+	}
+}
+
+static void bench_point() {
+	char k[32];
+	random_key(k);
+
+	ecpt P, Q;
+	ecpt_affine Pa;
+	ufe t2b;
+	ec_mul_gen((const u64 *)k, P, t2b);
+	ec_affine(P, Pa);
+	ec_expand(Pa, P);
+	ec_set(P, Q);
+
+	bench("ec_dbl", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) ec_dbl(Q, Q, false, t2b); });
+	bench("ec_add", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) ec_add(Q, P, Q, true, true, true, t2b); });
+	bench("ec_affine", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) ec_affine(Q, Pa); fe_set(Pa.x, Q.x); });
+	bench("ec_affine_vartime", 1, SLOW_REPS, [&] { for (int ii = 0; ii < SLOW_REPS; ++ii) ec_affine_vartime(Q, Pa); fe_set(Pa.x, Q.x); });
+	bench("ec_valid_vartime", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) m_sink += ec_valid_vartime(Pa); });
+
+	ecpt table[8] CAT_ALIGNED(64);
+	for (int ii = 0; ii < 8; ++ii) {
+		ec_set(P, table[ii]);
+	}
+	bench("ec_table_select", 8, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) ec_table_select(table, 8, ii & 7, Q); });
+
+	sink(&Q, sizeof(Q));
+}
+
+static void bench_engines() {
+	char a[32], b[32];
+	random_key(a);
+	random_key(b);
+	const u64 *ka = (const u64 *)a, *kb = (const u64 *)b;
+
+	ecpt P, Q, R;
+	ecpt_affine Pa, Qa, Ra;
+	ufe t2b;
+	ec_mul_gen(ka, P, t2b);
+	ec_affine(P, Pa);
+	ec_expand(Pa, P);
+	ec_mul_gen(kb, Q, t2b);
+	ec_affine(Q, Qa);
+	ec_expand(Qa, Q);
+
+	ecpt_prep prep;
+	ec_prepare(Qa, prep);
+
+	static ecpt tables[2][8] CAT_ALIGNED(64);
+	ec_gen_table_2_prep(Qa, tables);
+
+	ufp s1, s2;
+	s32 s1sign, s2sign;
+
+	bench("gls_decompose", 1, PRIM_REPS, [&] { for (int ii = 0; ii < PRIM_REPS; ++ii) gls_decompose(ka, s1sign, s1, s2sign, s2); });
+	bench("ec_mul_gen", 1, 1, [&] { ec_mul_gen(ka, R, t2b); });
+	bench("ec_mul", 1, 1, [&] { ec_mul(ka, P, true, R, t2b); });
+	bench("ec_mul_affine", 1, 1, [&] { ec_mul_affine(ka, Pa, Ra); });
+	bench("ec_simul_gen", 1, 1, [&] { ec_simul_gen(ka, kb, Q, true, R, t2b); });
+	bench("ec_simul_gen_affine", 1, 1, [&] { ec_simul_gen_affine(ka, kb, Qa, Ra); });
+	bench("ec_simul_gen_prep_affine", 1, 1, [&] { ec_simul_gen_prep_affine(ka, kb, tables, Ra); });
+	bench("ec_simul", 1, 1, [&] { ec_simul(ka, P, true, kb, Q, true, R, t2b); });
+	bench("ec_simul_affine", 1, 1, [&] { ec_simul_affine(ka, Pa, kb, Qa, Ra); });
+	bench("ec_simul_prep", 1, 1, [&] { ec_simul_prep(ka, P, true, kb, prep, R, t2b); });
+	bench("ec_elligator_decode", 1, 1, [&] { ec_elligator_decode(a, Ra); });
+	bench("ec_elligator_decode_proj", 1, 1, [&] { ec_elligator_decode_proj(a, R); });
+
+	u32 noise = 0;
+	char r0[32];
+	bench("ec_elligator_encode", 1, 1, [&] { m_sink += ec_elligator_encode(Pa, noise++, r0); });
+
+	vector<ecpt> buckets(EC_MSM_WINDOWS * EC_MSM_BUCKETS);
+	ec_msm_init(&buckets[0]);
+	bench("ec_msm_add", 1, 1, [&] { ec_msm_add(&buckets[0], ka, Pa); });
+
+	sink(&R, sizeof(R));
+	sink(&Ra, sizeof(Ra));
+}
+
+static void bench_api() {
+	char a[32], b[32], E[128], V[64], P[64], Q[64], R[64], prep[384];
+	char h[64], x64[64];
+	random_key(a);
+	random_key(b);
+	random_bytes(h, 64);
+	random_bytes(x64, 64);
+
+	snowshoe_mul_gen(a, P, 0);
+	snowshoe_mul_gen(b, Q, 0);
+	snowshoe_elligator(b, E);
+	snowshoe_mul_gen(a, V, 0);
+	snowshoe_elligator_prepare(E, V, prep);
+
+	char C[64];
+	snowshoe_elligator_encrypt(a, E, C);
+
+	bench("snowshoe_secret_gen", 1, 1, [&] { snowshoe_secret_gen(R); });
+	bench("snowshoe_mod_q", 1, 1, [&] { snowshoe_mod_q(x64, R); });
+	bench("snowshoe_mul_mod_q", 1, 1, [&] { snowshoe_mul_mod_q(a, b, a, R); });
+	bench("snowshoe_valid", 1, 1, [&] { m_sink += snowshoe_valid(P); });
+	bench("snowshoe_mul_gen", 1, 1, [&] { snowshoe_mul_gen(a, R, 0); });
+	bench("snowshoe_mul_gen_mul4", 1, 1, [&] { snowshoe_mul_gen(a, R, 1); });
+	bench("snowshoe_mul", 1, 1, [&] { snowshoe_mul(a, P, R); });
+	bench("snowshoe_simul_gen", 1, 1, [&] { snowshoe_simul_gen(a, b, Q, R); });
+	bench("snowshoe_simul", 1, 1, [&] { snowshoe_simul(a, P, b, Q, R); });
+
+	char sa[16], sb[16];
+	random_bytes(sa, 16);
+	random_bytes(sb, 16);
+	sa[0] |= 1;
+	sb[0] |= 1;
+	bench("snowshoe_short_scalar", 1, 1, [&] { snowshoe_short_scalar(sa, R); });
+	bench("snowshoe_mul_short", 1, 1, [&] { snowshoe_mul_short(sa, P, R); });
+	bench("snowshoe_simul_short", 1, 1, [&] { snowshoe_simul_short(sa, P, sb, Q, R); });
+
+	// Two-signer MuSig with keys (a, P) and (b, Q)
+	char mc[64], mA[128], mr[64], mN[128], ms[32];
+	memcpy(mc, a, 32);
+	memcpy(mc + 32, b, 32);
+	memcpy(mA, P, 64);
+	memcpy(mA + 64, Q, 64);
+	memcpy(mr, a, 32);
+	memcpy(mr + 32, b, 32);
+	snowshoe_musig_nonce(mr, mN);
+	bench("snowshoe_musig_key", 2, 2, [&] { snowshoe_musig_key(mc, mA, 2, R); });
+	bench("snowshoe_musig_nonce", 1, 1, [&] { snowshoe_musig_nonce(mr, mN); });
+	bench("snowshoe_musig_nonce_final", 1, 1, [&] { snowshoe_musig_nonce_final(mN, b, R); });
+	bench("snowshoe_musig_sign", 1, 1, [&] { snowshoe_musig_sign(a, b, mr, a, b, ms); });
+	bench("snowshoe_musig_verify_partial", 1, 1, [&] { m_sink += snowshoe_musig_verify_partial(P, a, mN, b, a, ms); });
+	bench("snowshoe_commit", 1, 1, [&] { snowshoe_commit(a, b, R); });
+
+	bench("snowshoe_elligator", 1, 1, [&] { snowshoe_elligator(a, E); });
+	bench("snowshoe_elligator_encrypt", 1, 1, [&] { snowshoe_elligator_encrypt(a, E, R); });
+	bench("snowshoe_elligator_secret", 1, 1, [&] { snowshoe_elligator_secret(a, C, E, b, V, R); });
+	bench("snowshoe_elligator_secret_prepared", 1, 1, [&] { snowshoe_elligator_secret_prepared(a, C, prep, b, R); });
+
+	unsigned noise = 0;
+	char r0[32];
+	bench("snowshoe_elligator_encode", 1, 1, [&] { m_sink += snowshoe_elligator_encode(P, noise++, r0); });
+	bench("snowshoe_elligator_decode", 1, 1, [&] { snowshoe_elligator_decode(r0, R); });
+	bench("snowshoe_keygen_elligator", 1, 1, [&] { char k[8 * 32]; for (int ii = 0; ii < 8; ++ii) random_key(k + ii * 32); snowshoe_keygen_elligator(k, 8, noise++, R, r0); });
+	bench("snowshoe_hash_to_curve", 1, 1, [&] { snowshoe_hash_to_curve(h, R); });
+
+	// Key directory with 1024 prepared keys
+	static const int KEYS = 1024;
+	vector<char> ids(32 * KEYS), points(64 * KEYS);
+	for (int ii = 0; ii < KEYS; ++ii) {
+		random_bytes(&ids[ii * 32], 32);
+		memcpy(&points[ii * 64], P, 64);
+	}
+	vector<char> dir((size_t)snowshoe_keydir_size(KEYS, 1));
+	snowshoe_keydir_build(&ids[0], &points[0], KEYS, 1, &dir[0]);
+
+	int next = 0;
+	bench("snowshoe_keydir_find", KEYS, 1, [&] { m_sink += (u64)snowshoe_keydir_find(&dir[0], &ids[(next++ % KEYS) * 32]); });
+
+	const char *entry = snowshoe_keydir_find(&dir[0], &ids[0]);
+	bench("snowshoe_keydir_simul_gen", 1, 1, [&] { snowshoe_keydir_simul_gen(a, b, entry, R); });
+
+	sink(R, 64);
+}
+
+static void bench_batches() {
+	static const int MAX = 128;
+
+	vector<char> keys(32 * MAX), blind(32 * MAX), h(64 * MAX), E(128 * MAX), R(64 * MAX), B(512 * (MAX / 8));
+	for (int ii = 0; ii < MAX; ++ii) {
+		random_key(&keys[ii * 32]);
+		random_key(&blind[ii * 32]);
+	}
+	random_bytes(&h[0], (int)h.size());
+
+	for (int n = 1; n <= MAX; n *= 2) {
+		bench("snowshoe_elligator_batch", n, n, [&] { snowshoe_elligator_batch(&keys[0], n, &E[0]); });
+	}
+
+	for (int n = 1; n <= MAX; n *= 2) {
+		bench("snowshoe_hash_to_curve_batch", n, n, [&] { snowshoe_hash_to_curve_batch(&h[0], n, &R[0]); });
+	}
+
+	for (int n = 8; n <= MAX; n *= 2) {
+		bench("snowshoe_hash_to_curve_batch_soa", n, n, [&] { snowshoe_hash_to_curve_batch_soa(&h[0], n, &B[0]); });
+	}
+
+	for (int n = 1; n <= MAX; n *= 2) {
+		bench("snowshoe_commit_batch", n, n, [&] { snowshoe_commit_batch(&keys[0], &blind[0], n, &R[0]); });
+	}
+
+	// Affine conversion with a shared inversion
+	vector<ecpt> pts(MAX);
+	vector<ecpt_affine> aff(MAX);
+	vector<ufp> d(MAX), scratch(MAX);
+	for (int ii = 0; ii < MAX; ++ii) {
+		ec_elligator_decode_proj(&keys[ii * 32], pts[ii]);
+	}
+
+	for (int n = 1; n <= MAX; n *= 2) {
+		bench("ec_affine_batch", n, n, [&] { ec_affine_batch(&pts[0], &aff[0], &d[0], &scratch[0], n); });
+	}
+
+	// Multi-scalar multiplication per term
+	static const int TERMS = 4096;
+	vector<char> terms(96 * TERMS), state(snowshoe_msm_size());
+	for (int ii = 0; ii < TERMS; ++ii) {
+		random_bytes(&terms[ii * 96], 32);
+		snowshoe_mul_gen(&keys[(ii % MAX) * 32], &terms[ii * 96 + 32], 0);
+	}
+	snowshoe_msm_init(&state[0]);
+
+	for (int n = 64; n <= TERMS; n *= 4) {
+		bench("snowshoe_msm_update", n, n, [&] { snowshoe_msm_update(&state[0], &terms[0], n); });
+	}
+
+	bench("snowshoe_msm_finish", 1, 1, [&] { snowshoe_msm_finish(&state[0], &R[0]); });
+
+	// Aggregate signature check: The inputs do not verify, but the work is the same
+	vector<char> z(32 * TERMS), t(32 * TERMS), A(64 * TERMS), sigR(64 * TERMS);
+	for (int ii = 0; ii < TERMS; ++ii) {
+		random_key(&z[ii * 32]);
+		random_key(&t[ii * 32]);
+		memcpy(&A[ii * 64], &terms[((ii + 1) % TERMS) * 96 + 32], 64);
+		memcpy(&sigR[ii * 64], &terms[ii * 96 + 32], 64);
+	}
+
+	for (int n = 64; n <= TERMS; n *= 4) {
+		bench("snowshoe_sig_verify_aggregate", n, n, [&] { snowshoe_sig_verify_aggregate(&z[0], &t[0], &A[0], &sigR[0], n, &keys[0]); });
+	}
+
+	sink(&E[0], 128);
+	sink(&R[0], 64);
+	sink(&aff[0], sizeof(ecpt_affine));
+}
+
+//// Scaling
+
+/*
+ * Each worker runs its own keys through the operation mix until told to
+ * stop, so nothing is shared between workers except the library tables.
+ * A step runs 1, 2, 4, ... threads and counts operations completed.
+ *
+ * Workers are pinned using the CPU topology from sysfs.  The "core" curve
+ * places one thread on each physical core before using SMT siblings, and
+ * the "smt" curve fills both siblings of a core before moving to the next,
+ * so the two show the cost of sharing a core.  Efficiency is throughput
+ * divided by the single-thread throughput times the number of threads.
+ */
+
+struct ScalingKeys {
+	char sk_s[32], sk_e[32], sk_c[32], h[32], d[32], a[32];
+	char pp_s[64], pp_e[64], pp_c[64], R[64], E[128];
+};
+
+struct ScalingOp {
+	const char *name;
+	void (*fn)(ScalingKeys &k);
+};
+
+static void scaling_mul_gen(ScalingKeys &k) {
+	snowshoe_mul_gen(k.sk_c, k.R, 0);
+}
+
+static void scaling_mul(ScalingKeys &k) {
+	snowshoe_mul(k.sk_c, k.pp_s, k.R);
+}
+
+static void scaling_simul_gen(ScalingKeys &k) {
+	snowshoe_simul_gen(k.sk_c, k.h, k.pp_s, k.R);
+}
+
+static void scaling_elligator(ScalingKeys &k) {
+	snowshoe_elligator(k.sk_c, k.E);
+}
+
+// EC-DH-FS server: d = sk_e + h * sk_s, R = 4d * pp_c
+static void scaling_dh_server(ScalingKeys &k) {
+	snowshoe_mul_mod_q(k.h, k.sk_s, k.sk_e, k.d);
+	snowshoe_mul(k.d, k.pp_c, k.R);
+}
+
+// EC-DH-FS client: pp_c = sk_c * G, R = 4sk_c * pp_e + 4(h * sk_c) * pp_s
+static void scaling_dh_client(ScalingKeys &k) {
+	snowshoe_mul_gen(k.sk_c, k.pp_c, 0);
+	snowshoe_mul_mod_q(k.h, k.sk_c, 0, k.a);
+	snowshoe_simul(k.sk_c, k.pp_e, k.a, k.pp_s, k.R);
+}
+
+static const ScalingOp m_scaling_ops[] = {
+	{ "mul_gen", scaling_mul_gen },
+	{ "mul", scaling_mul },
+	{ "simul_gen", scaling_simul_gen },
+	{ "elligator", scaling_elligator },
+	{ "dh_server", scaling_dh_server },
+	{ "dh_client", scaling_dh_client },
+};
+
+static const int SCALING_OPS = (int)(sizeof(m_scaling_ops) / sizeof(m_scaling_ops[0]));
+
+// Parse "name=weight,..." into a schedule of operation indices
+static bool scaling_parse_mix(const string &mix, vector<int> &schedule) {
+	schedule.clear();
+
+	if (mix.empty()) {
+		for (int ii = 0; ii < SCALING_OPS; ++ii) {
+			schedule.push_back(ii);
+		}
+		return true;
+	}
+
+	stringstream ss(mix);
+	string item;
+
+	while (getline(ss, item, ',')) {
+		const size_t eq = item.find('=');
+		const string name = item.substr(0, eq);
+		const int weight = eq == string::npos ? 1 : atoi(item.c_str() + eq + 1);
+
+		int op = -1;
+		for (int ii = 0; ii < SCALING_OPS; ++ii) {
+			if (name == m_scaling_ops[ii].name) {
+				op = ii;
+			}
+		}
+
+		if (op < 0 || weight < 0) {
+			cout << "Unknown operation in mix: " << item << endl;
+			return false;
+		}
+
+		for (int ii = 0; ii < weight; ++ii) {
+			schedule.push_back(op);
+		}
+	}
+
+	return !schedule.empty();
+}
+
+// Returns CPUs in the order the core and smt curves should use them
+static void scaling_topology(vector<int> &core_order, vector<int> &smt_order) {
+	core_order.clear();
+	smt_order.clear();
+
+	const int cpus = max(1, (int)thread::hardware_concurrency());
+
+	// (package, core) -> logical CPUs
+	vector<pair<pair<int, int>, int> > cpu_core;
+
+	for (int cpu = 0; cpu < cpus; ++cpu) {
+		int package = 0, core = cpu;
+
+#ifdef __linux__
+		stringstream path;
+		path << "/sys/devices/system/cpu/cpu" << cpu << "/topology/";
+
+		ifstream fp((path.str() + "physical_package_id").c_str());
+		ifstream fc((path.str() + "core_id").c_str());
+		if (fp && fc) {
+			fp >> package;
+			fc >> core;
+		}
+#endif
+
+		cpu_core.push_back(make_pair(make_pair(package, core), cpu));
+	}
+
+	sort(cpu_core.begin(), cpu_core.end());
+
+	// SMT siblings are adjacent after sorting
+	set<pair<int, int> > seen;
+	for (size_t ii = 0; ii < cpu_core.size(); ++ii) {
+		smt_order.push_back(cpu_core[ii].second);
+
+		if (seen.insert(cpu_core[ii].first).second) {
+			core_order.push_back(cpu_core[ii].second);
+		}
+	}
+}
+
+static void scaling_pin(thread &t, int cpu) {
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+#else
+	(void)t;
+	(void)cpu;
+#endif
+}
+
+static void scaling_worker(const vector<int> *schedule, int seed, atomic<int> *ready, atomic<bool> *go, atomic<bool> *stop, u64 *ops) {
+	ScalingKeys k;
+
+	// Inputs for this thread, set up before the clock starts.  rand() is
+	// shared between threads, so each one has its own seeded engine.
+	mt19937_64 rng(seed);
+	random_key(rng, k.sk_s);
+	random_key(rng, k.sk_e);
+	random_key(rng, k.sk_c);
+	random_key(rng, k.h);
+	snowshoe_mul_gen(k.sk_s, k.pp_s, 0);
+	snowshoe_mul_gen(k.sk_e, k.pp_e, 0);
+	snowshoe_mul_gen(k.sk_c, k.pp_c, 0);
+
+	++*ready;
+	while (!*go) {
+		this_thread::yield();
+	}
+
+	u64 count = 0;
+	size_t next = 0;
+
+	while (!stop->load(memory_order_relaxed)) {
+		m_scaling_ops[(*schedule)[next]].fn(k);
+		if (++next >= schedule->size()) {
+			next = 0;
+		}
+		++count;
+	}
+
+	sink(k.R, 64);
+	*ops = count;
+}
+
+// Returns operations per second for threads pinned to the first n CPUs
+static double scaling_step(const vector<int> &schedule, const vector<int> &cpus, int n, double seconds) {
+	atomic<int> ready(0);
+	atomic<bool> go(false), stop(false);
+	vector<u64> ops(n);
+	vector<thread> workers;
+
+	for (int ii = 0; ii < n; ++ii) {
+		workers.push_back(thread(scaling_worker, &schedule, ii + 1, &ready, &go, &stop, &ops[ii]));
+		scaling_pin(workers.back(), cpus[ii % cpus.size()]);
+	}
+
+	while (ready < n) {
+		this_thread::yield();
+	}
+
+	const auto t0 = chrono::steady_clock::now();
+	go = true;
+
+	this_thread::sleep_for(chrono::duration<double>(seconds));
+
+	stop = true;
+	const auto t1 = chrono::steady_clock::now();
+
+	u64 total = 0;
+	for (int ii = 0; ii < n; ++ii) {
+		workers[ii].join();
+		total += ops[ii];
+	}
+
+	return total / chrono::duration<double>(t1 - t0).count();
+}
+
+struct ScalingResult {
+	string curve;
+	int threads, cores;
+	double ops_per_sec, per_core, efficiency;
+};
+
+static void scaling_curve(const string &curve, const vector<int> &schedule, const vector<int> &cpus, const vector<int> &core_order, int max_threads, double seconds, double single, vector<ScalingResult> &results) {
+	vector<int> steps;
+	for (int n = 1; n < max_threads; n *= 2) {
+		steps.push_back(n);
+	}
+	steps.push_back(max_threads);
+
+	// Physical cores used by the first n CPUs of this curve
+	const set<int> first_siblings(core_order.begin(), core_order.end());
+
+	for (size_t ii = 0; ii < steps.size(); ++ii) {
+		const int n = steps[ii];
+
+		int cores = 0;
+		for (int jj = 0; jj < n && jj < (int)cpus.size(); ++jj) {
+			cores += first_siblings.count(cpus[jj]) ? 1 : 0;
+		}
+		cores = max(cores, 1);
+
+		// Single-thread throughput is shared by both curves
+		if (n == 1 && single <= 0) {
+			single = scaling_step(schedule, cpus, 1, seconds);
+		}
+
+		ScalingResult r;
+		r.curve = curve;
+		r.threads = n;
+		r.cores = cores;
+		r.ops_per_sec = n == 1 ? single : scaling_step(schedule, cpus, n, seconds);
+		r.per_core = r.ops_per_sec / cores;
+		r.efficiency = r.ops_per_sec / single / n;
+
+		cout << left << setw(8) << curve << right << setw(8) << n << setw(8) << cores
+			<< fixed << setprecision(1) << setw(16) << r.ops_per_sec << setw(16) << r.per_core
+			<< setprecision(3) << setw(12) << r.efficiency << endl;
+
+		results.push_back(r);
+	}
+}
+
+static int run_scaling(double seconds, int max_threads, const string &mix, const string &json) {
+	vector<int> schedule;
+	if (!scaling_parse_mix(mix, schedule)) {
+		return 1;
+	}
+
+	vector<int> core_order, smt_order;
+	scaling_topology(core_order, smt_order);
+
+	if (max_threads <= 0) {
+		max_threads = (int)smt_order.size();
+	}
+
+	cout << "Scaling " << (mix.empty() ? "equal mix" : mix) << " for " << seconds << " s per step on "
+		<< core_order.size() << " cores / " << smt_order.size() << " CPUs" << endl << endl;
+	cout << left << setw(8) << "curve" << right << setw(8) << "threads" << setw(8) << "cores"
+		<< setw(16) << "ops/sec" << setw(16) << "ops/sec/core" << setw(12) << "efficiency" << endl;
+
+	vector<ScalingResult> results;
+
+	// Only worth running the smt curve when there are SMT siblings to fill
+	const bool smt = smt_order.size() > core_order.size() && max_threads > 1;
+
+	scaling_curve("core", schedule, core_order, core_order, smt ? min(max_threads, (int)core_order.size()) : max_threads, seconds, 0, results);
+
+	if (smt) {
+		scaling_curve("smt", schedule, smt_order, core_order, max_threads, seconds, results[0].ops_per_sec, results);
+	}
+
+	if (!json.empty()) {
+		ofstream f(json.c_str());
+		if (!f) {
+			cout << "Unable to write " << json << endl;
+			return 1;
+		}
+
+		f << "{\n\t\"mix\": \"" << mix << "\",\n\t\"seconds\": " << seconds << ",\n\t\"scaling\": [\n";
+
+		for (size_t ii = 0; ii < results.size(); ++ii) {
+			const ScalingResult &r = results[ii];
+
+			f << "\t\t{\"curve\": \"" << r.curve << "\", \"threads\": " << r.threads
+				<< ", \"cores\": " << r.cores << ", \"ops_per_sec\": " << r.ops_per_sec
+				<< ", \"ops_per_sec_per_core\": " << r.per_core
+				<< ", \"efficiency\": " << r.efficiency << "}"
+				<< (ii + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		f << "\t]\n}\n";
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	string json, baseline;
+	double threshold = 5;
+	int cpu = 0;
+	bool use_perf = true;
+	double scaling = 0;
+	int threads = 0;
+	string mix;
+
+	for (int ii = 1; ii < argc; ++ii) {
+		const string arg = argv[ii];
+		const char *value = ii + 1 < argc ? argv[ii + 1] : "";
+
+		if (arg == "--json") {
+			json = value; ++ii;
+		} else if (arg == "--baseline") {
+			baseline = value; ++ii;
+		} else if (arg == "--threshold") {
+			threshold = atof(value); ++ii;
+		} else if (arg == "--filter") {
+			m_filter = value; ++ii;
+		} else if (arg == "--samples") {
+			m_samples = max(1, atoi(value)); ++ii;
+		} else if (arg == "--cpu") {
+			cpu = atoi(value); ++ii;
+		} else if (arg == "--no-perf") {
+			use_perf = false;
+		} else if (arg == "--scaling") {
+			scaling = atof(value); ++ii;
+		} else if (arg == "--threads") {
+			threads = atoi(value); ++ii;
+		} else if (arg == "--mix") {
+			mix = value; ++ii;
+		} else {
+			cout << "Unknown option " << arg << endl;
+			return 1;
+		}
+	}
+
+	cout << "Snowshoe Benchmarks" << endl;
+
+	m_clock.OnInitialize();
+
+	if (snowshoe_init()) {
+		throw "Wrong snowshoe static library is linked";
+	}
+
+	if (scaling > 0) {
+		const int result = run_scaling(scaling, threads, mix, json);
+
+		m_clock.OnFinalize();
+
+		return result;
+	}
+
+	pin_cpu(cpu);
+	tscTime();
+	srand(0);
+
+	cout << "RDTSC instruction runs at " << m_ghz << " GHz" << endl;
+
+	m_perf = use_perf && perf_init();
+	if (m_perf) {
+		cout << "Reading core cycles from perf_event" << endl << endl;
+	} else {
+		tscCalibrate();
+		cout << "perf_event unavailable: core clock runs at " << m_tsc_ratio
+			<< " cycles per RDTSC tick (" << m_ghz * m_tsc_ratio << " GHz)" << endl << endl;
+	}
+
+	cout << left << setw(40) << "name" << right << setw(6) << "batch"
+		<< setw(14) << "median cyc" << setw(14) << "p99 cyc"
+		<< setw(14) << "mean cyc" << setw(14) << "median ns";
+	if (m_perf) {
+		cout << setw(8) << "IPC" << setw(10) << "br-miss" << setw(10) << "L1D-miss"
+			<< setw(10) << "LLC-miss" << setw(10) << "dTLB-miss";
+	}
+	cout << endl;
+
+	bench_field();
+	bench_point();
+	bench_engines();
+	bench_api();
+	bench_batches();
+
+	int result = 0;
+
+	if (!json.empty() && !write_json(json)) {
+		cout << "Unable to write " << json << endl;
+		result = 1;
+	}
+
+	if (!baseline.empty()) {
+		const int regressions = compare_baseline(baseline, threshold);
+
+		if (regressions < 0) {
+			cout << "Unable to read " << baseline << endl;
+			result = 1;
+		} else if (regressions > 0) {
+			result = 2;
+		}
+	}
+
+	perf_shutdown();
+	m_clock.OnFinalize();
+
+	return result;
+}
@@ -0,0 +1,236 @@
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+#ifdef __linux__
+#include <poll.h>
+#endif
+
+// C++20 interface
+#include "snowshoe.hpp"
+using namespace snowshoe;
+
+
+//// Test Driver
+
+static void generate_k(char kb[32]) {
+	for (int ii = 0; ii < 32; ++ii) {
+		kb[ii] = (char)(rand() >> 3);
+	}
+}
+
+static SecretScalar random_secret() {
+	char r[32];
+	generate_k(r);
+	return SecretScalar(span<const char, 32>(r, 32));
+}
+
+static Scalar public_copy(const SecretScalar &k) {
+	Scalar s;
+	memcpy(s.bytes, k.data(), 32);
+	return s;
+}
+
+// Coroutine that runs until its first suspension when called
+struct Task {
+	struct promise_type {
+		Task get_return_object() { return Task(); }
+		suspend_never initial_suspend() noexcept { return {}; }
+		suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { abort(); }
+	};
+};
+
+static Task ring_mul(Ring &ring, const SecretScalar &k, const Point &P, Point &R, int &result) {
+	result = (co_await ring.mul(k, P, R)) ? 0 : -1;
+}
+
+static bool values_test() {
+	SecretScalar a = random_secret(), b = random_secret();
+
+	// Moving erases the source
+	SecretScalar c = random_secret();
+	SecretScalar d = std::move(c);
+	static const char zero[32] = {};
+	if (memcmp(c.data(), zero, 32) != 0) {
+		cout << "moved-from secret not erased" << endl;
+		return false;
+	}
+
+	auto P = mul_gen(a), Q = mul_gen(b);
+	char expected[64];
+	if (!P || !Q || snowshoe_mul_gen(a.data(), expected, 0) || memcmp(P->bytes, expected, 64) != 0) {
+		cout << "mul_gen mismatch" << endl;
+		return false;
+	}
+
+	// Prepared and unprepared verification agree
+	auto prepared = PreparedPoint::prepare(*Q);
+	Scalar sa = public_copy(a), sd = public_copy(d);
+	auto R1 = simul_gen(sa, sd, *Q);
+	auto R2 = simul_gen(sa, sd, *prepared);
+	if (!prepared || !R1 || !R2 || memcmp(R1->bytes, R2->bytes, 64) != 0) {
+		cout << "prepared simul_gen mismatch" << endl;
+		return false;
+	}
+
+	// A copy has its own entry and outlives the original
+	auto copy = std::make_optional(*prepared);
+	prepared.reset();
+	auto R3 = simul_gen(sa, sd, *copy);
+	if (!R3 || memcmp(R1->bytes, R3->bytes, 64) != 0) {
+		cout << "copied prepared point mismatch" << endl;
+		return false;
+	}
+
+	// Two-term MSM matches simul
+	Term terms[2] = { { sa, *P }, { public_copy(d), *Q } };
+	auto S1 = msm(terms);
+	auto S2 = simul(a, *P, d, *Q);
+	if (!S1 || !S2 || memcmp(S1->bytes, S2->bytes, 64) != 0) {
+		cout << "msm mismatch" << endl;
+		return false;
+	}
+
+	// Invalid scalar
+	if (mul_gen(SecretScalar())) {
+		cout << "mul_gen accepted zero" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+static bool batch_test() {
+	static const int N = 40;
+
+	vector<SecretScalar> k;
+	vector<Scalar> keys(N);
+	vector<ElligatorPoint> E(N);
+	vector<Point> P(N), R(N);
+
+	for (int ii = 0; ii < N; ++ii) {
+		k.push_back(random_secret());
+		keys[ii] = public_copy(k[ii]);
+	}
+
+	if (!elligator(keys, E)) {
+		cout << "elligator batch failed" << endl;
+		return false;
+	}
+
+	for (int ii = 0; ii < N; ++ii) {
+		auto e = elligator(keys[ii]);
+
+		if (!e || memcmp(e->bytes, E[ii].bytes, 128) != 0) {
+			cout << "elligator batch mismatch" << endl;
+			return false;
+		}
+	}
+
+	Pool pool(2);
+	if (!pool || !pool.mul_gen(k, P) || !pool.mul(k, P, R)) {
+		cout << "pool failed" << endl;
+		return false;
+	}
+
+	for (int ii = 0; ii < N; ++ii) {
+		auto r = mul(k[ii], P[ii]);
+
+		if (!r || memcmp(r->bytes, R[ii].bytes, 64) != 0) {
+			cout << "pool mismatch" << endl;
+			return false;
+		}
+	}
+
+	// Mismatched sizes are rejected
+	if (pool.mul_gen(k, span<Point>(P).first(N - 1))) {
+		cout << "pool accepted mismatched spans" << endl;
+		return false;
+	}
+
+	// Empty spans are fine
+	if (!elligator(span<const Scalar>(), span<ElligatorPoint>()) ||
+		!pool.mul_gen(span<const SecretScalar>(), span<Point>()) ||
+		!pool.msm(span<const Term>())) {
+		cout << "empty batch failed" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+static bool ring_test() {
+	static const int N = 50;
+
+	// Smaller than N so that some operations wait for room
+	Ring ring(16, 2);
+	if (!ring) {
+		cout << "ring create failed" << endl;
+		return false;
+	}
+
+	vector<SecretScalar> k;
+	vector<Point> P(N), R(N);
+	vector<int> results(N, 1);
+
+	for (int ii = 0; ii < N; ++ii) {
+		k.push_back(random_secret());
+		P[ii] = *mul_gen(k[ii]);
+	}
+
+	for (int ii = 0; ii < N; ++ii) {
+		ring_mul(ring, k[(ii + 1) % N], P[ii], R[ii], results[ii]);
+	}
+
+	int completed = 0;
+	while (completed < N) {
+#ifdef __linux__
+		pollfd pfd;
+		pfd.fd = ring.fd();
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, 10000) != 1) {
+			cout << "ring poll timed out" << endl;
+			return false;
+		}
+#endif
+
+		completed += ring.dispatch();
+	}
+
+	for (int ii = 0; ii < N; ++ii) {
+		auto r = mul(k[(ii + 1) % N], P[ii]);
+
+		if (results[ii] != 0 || !r || memcmp(r->bytes, R[ii].bytes, 64) != 0) {
+			cout << "ring mismatch" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main() {
+	cout << "Snowshoe C++ Interface Unit Tester" << endl;
+
+	// Note that assert() should not be used for crypto code since it is often compiled
+	// out in release mode.  It is only used here for testing.
+
+	srand(0);
+
+	if (snowshoe_init()) {
+		throw "Wrong snowshoe static library is linked";
+	}
+
+	assert(values_test());
+	assert(batch_test());
+	assert(ring_test());
+
+	cout << "All tests passed successfully." << endl;
+
+	return 0;
+}
@@ -0,0 +1,613 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+// POSIX sockets
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+
+// Math library
+#include "snowshoe.h"
+
+
+//// Handshake Load Generator
+
+/*
+ * An EC-DH-FS server and N client threads talk over loopback, using the
+ * same flow as ec_dh_fs_test in snowshoe_test.cpp:
+ *
+ *	Client -> Server: pp_c = sk_c * G, client nonce              (96 bytes)
+ *	Server -> Client: pp_e, server nonce, first half of the secret (128 bytes)
+ *
+ *	h = (client nonce || server nonce) mod q
+ *	Server: d = sk_e + h * sk_s (mod q), secret = 4d * pp_c
+ *	Client: a = h * sk_c (mod q), secret = 4sk_c * pp_e + 4a * pp_s
+ *
+ * A real protocol would hash the transcript into h and reply with a MAC
+ * instead of key material, which costs little next to the curve math.
+ * Each client keeps its connection open and runs one handshake after
+ * another until the time is up.
+ *
+ * The server runs in one of three ways:
+ *	direct    One thread per connection calling snowshoe_mul()
+ *	coalesce  One thread per connection calling snowshoe_coalesced_mul(),
+ *	          so concurrent handshakes share an inversion
+ *	ring      One event loop thread that polls the connections and submits
+ *	          the work to the asynchronous rings
+ *
+ * Latency is measured by the client from key generation to a verified
+ * secret.  CPU time is split between the server and the clients using
+ * the per-thread CPU clocks of the client threads.
+ *
+ * Options:
+ *	--server MODE     direct, coalesce or ring (default ring)
+ *	--clients N       Client threads (default 8)
+ *	--seconds S       Run time (default 5)
+ *	--tcp             Use TCP on 127.0.0.1 instead of a Unix socket
+ *	--threads N       Ring worker threads (default one per CPU)
+ *	--budget USEC     Coalescer wait budget (default 50)
+ *	--lanes N         Coalescer batch size (default 8)
+ */
+
+static const int REQUEST_BYTES = 96;
+static const int RESPONSE_BYTES = 128;
+
+// Point buffers are aligned like the library's own point types
+#define ALIGNED alignas(16)
+
+// Server keys
+ALIGNED static char m_sk_s[32], m_sk_e[32], m_pp_s[64], m_pp_e[64];
+
+static atomic<bool> m_go(false), m_stop(false);
+
+static void random_bytes(mt19937_64 &rng, char *data, int bytes) {
+	for (int ii = 0; ii < bytes; ++ii) {
+		data[ii] = (char)rng();
+	}
+}
+
+static void random_key(mt19937_64 &rng, char k[32]) {
+	random_bytes(rng, k, 32);
+	snowshoe_secret_gen(k);
+}
+
+static double cpu_thread_usec() {
+	timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static double cpu_process_usec() {
+	rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1e6 + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+static bool read_all(int fd, char *data, int bytes) {
+	while (bytes > 0) {
+		const ssize_t n = read(fd, data, bytes);
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		bytes -= (int)n;
+	}
+	return true;
+}
+
+static bool write_all(int fd, const char *data, int bytes) {
+	while (bytes > 0) {
+		const ssize_t n = write(fd, data, bytes);
+		if (n <= 0) {
+			return false;
+		}
+		data += n;
+		bytes -= (int)n;
+	}
+	return true;
+}
+
+
+//// Sockets
+
+struct Endpoint {
+	bool tcp;
+	string path;
+	int port;
+};
+
+static int listen_socket(Endpoint &ep, int backlog) {
+	int fd;
+
+	if (ep.tcp) {
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return -1;
+		}
+
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = 0;
+
+		socklen_t len = sizeof(addr);
+		if (bind(fd, (sockaddr *)&addr, sizeof(addr)) ||
+			getsockname(fd, (sockaddr *)&addr, &len)) {
+			close(fd);
+			return -1;
+		}
+
+		ep.port = ntohs(addr.sin_port);
+	} else {
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return -1;
+		}
+
+		stringstream path;
+		path << "/tmp/snowshoe-handshake-" << getpid() << ".sock";
+		ep.path = path.str();
+		unlink(ep.path.c_str());
+
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, ep.path.c_str(), sizeof(addr.sun_path) - 1);
+
+		if (bind(fd, (sockaddr *)&addr, sizeof(addr))) {
+			close(fd);
+			return -1;
+		}
+	}
+
+	if (listen(fd, backlog)) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static int connect_socket(const Endpoint &ep) {
+	int fd;
+
+	if (ep.tcp) {
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return -1;
+		}
+
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons((unsigned short)ep.port);
+
+		if (connect(fd, (sockaddr *)&addr, sizeof(addr))) {
+			close(fd);
+			return -1;
+		}
+
+		// Messages are sent whole, so do not wait to coalesce them
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	} else {
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0) {
+			return -1;
+		}
+
+		sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, ep.path.c_str(), sizeof(addr.sun_path) - 1);
+
+		if (connect(fd, (sockaddr *)&addr, sizeof(addr))) {
+			close(fd);
+			return -1;
+		}
+	}
+
+	return fd;
+}
+
+
+//// Client
+
+struct ClientStats {
+	vector<double> latency_usec;
+	unsigned long long failures;
+	double cpu_usec;
+};
+
+static void client_run(const Endpoint *ep, int seed, atomic<int> *connected, ClientStats *stats) {
+	mt19937_64 rng(seed);
+	stats->failures = 0;
+	stats->cpu_usec = 0;
+
+	const int fd = connect_socket(*ep);
+	++*connected;
+
+	if (fd < 0) {
+		++stats->failures;
+		return;
+	}
+
+	while (!m_go) {
+		this_thread::yield();
+	}
+
+	const double cpu0 = cpu_thread_usec();
+
+	while (!m_stop) {
+		const auto t0 = chrono::steady_clock::now();
+
+		// Client ephemeral key and nonce
+		ALIGNED char sk_c[32], request[REQUEST_BYTES];
+		random_key(rng, sk_c);
+		random_bytes(rng, request + 64, 32);
+
+		if (snowshoe_mul_gen(sk_c, request, 0)) {
+			++stats->failures;
+			break;
+		}
+
+		ALIGNED char response[RESPONSE_BYTES];
+		if (!write_all(fd, request, REQUEST_BYTES) ||
+			!read_all(fd, response, RESPONSE_BYTES)) {
+			++stats->failures;
+			break;
+		}
+
+		// h = (client nonce || server nonce) mod q
+		ALIGNED char nonces[64], h[32], a[32], sp_c[64];
+		memcpy(nonces, request + 64, 32);
+		memcpy(nonces + 32, response + 64, 32);
+		snowshoe_mod_q(nonces, h);
+
+		// a = h * sk_c (mod q)
+		snowshoe_mul_mod_q(h, sk_c, 0, a);
+
+		if (snowshoe_simul(sk_c, response, a, m_pp_s, sp_c) ||
+			memcmp(sp_c, response + 96, 32) != 0) {
+			++stats->failures;
+			continue;
+		}
+
+		const auto t1 = chrono::steady_clock::now();
+		stats->latency_usec.push_back(chrono::duration<double, micro>(t1 - t0).count());
+	}
+
+	stats->cpu_usec = cpu_thread_usec() - cpu0;
+
+	close(fd);
+}
+
+
+//// Server
+
+// Fills in the response around the secret computed from d
+static void server_prepare(mt19937_64 &rng, const char request[REQUEST_BYTES], char d[32], char response[RESPONSE_BYTES]) {
+	memcpy(response, m_pp_e, 64);
+	random_bytes(rng, response + 64, 32);
+
+	// h = (client nonce || server nonce) mod q
+	ALIGNED char nonces[64], h[32];
+	memcpy(nonces, request + 64, 32);
+	memcpy(nonces + 32, response + 64, 32);
+	snowshoe_mod_q(nonces, h);
+
+	// d = sk_e + h * sk_s (mod q)
+	snowshoe_mul_mod_q(h, m_sk_s, m_sk_e, d);
+}
+
+// One thread per connection, with or without the coalescer
+static void server_connection(int fd, int seed, snowshoe_coalescer *c) {
+	mt19937_64 rng(seed);
+	ALIGNED char request[REQUEST_BYTES], response[RESPONSE_BYTES], d[32], sp_s[64];
+
+	while (read_all(fd, request, REQUEST_BYTES)) {
+		server_prepare(rng, request, d, response);
+
+		const int result = c ? snowshoe_coalesced_mul(c, d, request, sp_s) : snowshoe_mul(d, request, sp_s);
+		if (result) {
+			break;
+		}
+
+		memcpy(response + 96, sp_s, 32);
+
+		if (!write_all(fd, response, RESPONSE_BYTES)) {
+			break;
+		}
+	}
+
+	close(fd);
+}
+
+struct RingConnection {
+	int fd;
+	bool busy;
+	ALIGNED char request[REQUEST_BYTES], response[RESPONSE_BYTES];
+	ALIGNED char d[32], sp_s[64];
+};
+
+// One event loop thread that hands the curve math to the rings
+static void server_ring(vector<int> fds, snowshoe_ring *ring) {
+	mt19937_64 rng(1);
+	const int n = (int)fds.size();
+	vector<RingConnection> conns(n);
+	vector<pollfd> pfds(n + 1);
+	int open = n;
+
+	for (int ii = 0; ii < n; ++ii) {
+		conns[ii].fd = fds[ii];
+		conns[ii].busy = false;
+	}
+
+	const int ring_fd = snowshoe_ring_fd(ring);
+
+	while (open > 0) {
+		pfds[0].fd = ring_fd;
+		pfds[0].events = POLLIN;
+
+		// Do not read from a connection until its last request is answered
+		for (int ii = 0; ii < n; ++ii) {
+			pfds[ii + 1].fd = conns[ii].busy ? -1 : conns[ii].fd;
+			pfds[ii + 1].events = POLLIN;
+			pfds[ii + 1].revents = 0;
+		}
+
+		// Without an eventfd, check for completions every millisecond
+		if (poll(&pfds[0], n + 1, ring_fd < 0 ? 1 : -1) < 0) {
+			break;
+		}
+
+		for (int ii = 0; ii < n; ++ii) {
+			if (!pfds[ii + 1].revents) {
+				continue;
+			}
+
+			RingConnection &conn = conns[ii];
+
+			if (!read_all(conn.fd, conn.request, REQUEST_BYTES)) {
+				close(conn.fd);
+				conn.fd = -1;
+				--open;
+				continue;
+			}
+
+			server_prepare(rng, conn.request, conn.d, conn.response);
+
+			snowshoe_op op;
+			memset(&op, 0, sizeof(op));
+			op.tag = ii;
+			op.op = SNOWSHOE_OP_MUL;
+			op.a = conn.d;
+			op.P = conn.request;
+			op.R = conn.sp_s;
+
+			// The rings hold one operation per connection, so this cannot fail
+			snowshoe_ring_submit(ring, &op, 1);
+			conn.busy = true;
+		}
+
+		snowshoe_completion done[64];
+		int count;
+
+		while ((count = snowshoe_ring_complete(ring, done, 64)) > 0) {
+			for (int ii = 0; ii < count; ++ii) {
+				RingConnection &conn = conns[(int)done[ii].tag];
+				conn.busy = false;
+
+				memcpy(conn.response + 96, conn.sp_s, 32);
+
+				if (done[ii].result || !write_all(conn.fd, conn.response, RESPONSE_BYTES)) {
+					close(conn.fd);
+					conn.fd = -1;
+					--open;
+				}
+			}
+		}
+	}
+}
+
+
+//// Entrypoint
+
+static double percentile(vector<double> &v, double p) {
+	if (v.empty()) {
+		return 0;
+	}
+	const size_t k = (size_t)(p * (v.size() - 1) + 0.5);
+	nth_element(v.begin(), v.begin() + k, v.end());
+	return v[k];
+}
+
+int main(int argc, char **argv) {
+	string mode = "ring";
+	int clients = 8, threads = 0, budget = 50, lanes = 8;
+	double seconds = 5;
+	Endpoint ep;
+	ep.tcp = false;
+	ep.port = 0;
+
+	for (int ii = 1; ii < argc; ++ii) {
+		const string arg = argv[ii];
+		const char *value = ii + 1 < argc ? argv[ii + 1] : "";
+
+		if (arg == "--server") {
+			mode = value; ++ii;
+		} else if (arg == "--clients") {
+			clients = max(1, atoi(value)); ++ii;
+		} else if (arg == "--seconds") {
+			seconds = atof(value); ++ii;
+		} else if (arg == "--tcp") {
+			ep.tcp = true;
+		} else if (arg == "--threads") {
+			threads = atoi(value); ++ii;
+		} else if (arg == "--budget") {
+			budget = atoi(value); ++ii;
+		} else if (arg == "--lanes") {
+			lanes = atoi(value); ++ii;
+		} else {
+			cout << "Unknown option " << arg << endl;
+			return 1;
+		}
+	}
+
+	if (mode != "direct" && mode != "coalesce" && mode != "ring") {
+		cout << "Unknown server mode " << mode << endl;
+		return 1;
+	}
+
+	cout << "Snowshoe Handshake Load Generator" << endl;
+
+	if (snowshoe_init()) {
+		throw "Wrong snowshoe static library is linked";
+	}
+
+	// Server long-term and ephemeral keys
+	mt19937_64 rng(0);
+	random_key(rng, m_sk_s);
+	random_key(rng, m_sk_e);
+	if (snowshoe_mul_gen(m_sk_s, m_pp_s, 0) || snowshoe_mul_gen(m_sk_e, m_pp_e, 0)) {
+		cout << "Unable to generate server keys" << endl;
+		return 1;
+	}
+
+	const int listener = listen_socket(ep, clients);
+	if (listener < 0) {
+		cout << "Unable to listen" << endl;
+		return 1;
+	}
+
+	// Connect every client before the clock starts
+	atomic<int> connected(0);
+	vector<ClientStats> stats(clients);
+	vector<thread> client_threads;
+
+	for (int ii = 0; ii < clients; ++ii) {
+		client_threads.push_back(thread(client_run, &ep, ii + 1, &connected, &stats[ii]));
+	}
+
+	vector<int> fds;
+	for (int ii = 0; ii < clients; ++ii) {
+		const int fd = accept(listener, 0, 0);
+		if (fd < 0) {
+			break;
+		}
+
+		if (ep.tcp) {
+			int one = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		}
+
+		fds.push_back(fd);
+	}
+
+	while (connected < clients) {
+		this_thread::yield();
+	}
+
+	close(listener);
+	if (!ep.tcp) {
+		unlink(ep.path.c_str());
+	}
+
+	snowshoe_coalescer *coalescer = 0;
+	snowshoe_ring *ring = 0;
+	vector<thread> server_threads;
+
+	if (mode == "ring") {
+		ring = snowshoe_ring_create(max(clients, 32), threads);
+		if (!ring) {
+			cout << "Unable to create rings" << endl;
+			return 1;
+		}
+
+		server_threads.push_back(thread(server_ring, fds, ring));
+	} else {
+		if (mode == "coalesce") {
+			coalescer = snowshoe_coalescer_create(budget, min(lanes, clients));
+			if (!coalescer) {
+				cout << "Unable to create coalescer" << endl;
+				return 1;
+			}
+		}
+
+		for (size_t ii = 0; ii < fds.size(); ++ii) {
+			server_threads.push_back(thread(server_connection, fds[ii], (int)ii + 1000, coalescer));
+		}
+	}
+
+	cout << clients << " clients, " << mode << " server over " << (ep.tcp ? "TCP" : "Unix") << " sockets for " << seconds << " s" << endl << endl;
+
+	const double cpu0 = cpu_process_usec();
+	const auto t0 = chrono::steady_clock::now();
+	m_go = true;
+
+	this_thread::sleep_for(chrono::duration<double>(seconds));
+
+	m_stop = true;
+
+	for (size_t ii = 0; ii < client_threads.size(); ++ii) {
+		client_threads[ii].join();
+	}
+
+	const auto t1 = chrono::steady_clock::now();
+	const double cpu1 = cpu_process_usec();
+
+	for (size_t ii = 0; ii < server_threads.size(); ++ii) {
+		server_threads[ii].join();
+	}
+
+	snowshoe_ring_free(ring);
+	snowshoe_coalescer_free(coalescer);
+
+	// Combine the client results
+	vector<double> latency;
+	unsigned long long failures = 0;
+	double client_cpu = 0;
+
+	for (int ii = 0; ii < clients; ++ii) {
+		latency.insert(latency.end(), stats[ii].latency_usec.begin(), stats[ii].latency_usec.end());
+		failures += stats[ii].failures;
+		client_cpu += stats[ii].cpu_usec;
+	}
+
+	const double elapsed = chrono::duration<double>(t1 - t0).count();
+	const double handshakes = (double)latency.size();
+	const double total_cpu = cpu1 - cpu0;
+	const double server_cpu = max(0.0, total_cpu - client_cpu);
+
+	cout << fixed << setprecision(1);
+	cout << "Handshakes: " << (unsigned long long)handshakes << " (" << failures << " failed)" << endl;
+	cout << "Handshakes/sec: " << handshakes / elapsed << endl;
+	cout << "Latency usec: p50 " << percentile(latency, 0.5) << ", p99 " << percentile(latency, 0.99)
+		<< ", p999 " << percentile(latency, 0.999) << endl;
+
+	if (handshakes > 0) {
+		cout << "CPU usec per handshake: " << total_cpu / handshakes << " total, "
+			<< server_cpu / handshakes << " server, " << client_cpu / handshakes << " client" << endl;
+	}
+
+	return failures ? 1 : 0;
+}
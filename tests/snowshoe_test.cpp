@@ -3,8 +3,13 @@
 #include <cassert>
 #include <vector>
 #include <cstdlib>
+#include <thread>
 using namespace std;
 
+#ifdef __linux__
+#include <poll.h>
+#endif
+
 #include "Clock.hpp"
 using namespace cat;
 
@@ -495,6 +500,1562 @@ static bool ec_elligator_test() {
 }
 
 
+static bool ec_elligator_batch_test() {
+	static const int N = 100;
+
+	vector<u32> t;
+	double wall = 0;
+
+	for (int iteration = 0; iteration < 100; ++iteration) {
+		char keys[32 * N];
+		char E[128 * N];
+
+		for (int ii = 0; ii < N; ++ii) {
+			generate_k(keys + ii * 32);
+		}
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		if (snowshoe_elligator_batch(keys, N, E)) {
+			cout << "elligator batch failed" << endl;
+			return false;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		t.push_back((t1 - t0) / N);
+		wall += (s1 - s0) / N;
+
+		// Check each point against the single version
+		for (int ii = 0; ii < N; ++ii) {
+			char E1[128], x[32], C1[64], C2[64];
+
+			if (snowshoe_elligator(keys + ii * 32, E1)) {
+				cout << "elligator failed" << endl;
+				return false;
+			}
+
+			generate_k(x);
+			snowshoe_secret_gen(x);
+
+			if (snowshoe_elligator_encrypt(x, E1, C1) ||
+				snowshoe_elligator_encrypt(x, E + ii * 128, C2)) {
+				cout << "elligator batch encrypt failed" << endl;
+				return false;
+			}
+
+			for (int jj = 0; jj < 64; ++jj) {
+				if (C1[jj] != C2[jj]) {
+					cout << "elligator batch points do not match " << ii << endl;
+					return false;
+				}
+			}
+		}
+	}
+
+	u32 median = quick_select(&t[0], (int)t.size());
+	wall /= t.size();
+
+	cout << "+ Elligator batch key: `" << dec << median << "` median cycles, `" << wall << "` avg usec per key" << endl;
+
+	return true;
+}
+
+static bool ec_keygen_elligator_test() {
+	vector<u32> t;
+	double wall = 0;
+
+	int failures = 0;
+
+	for (int iteration = 0; iteration < 10000; ++iteration) {
+		char keys[8 * 32], P[64], R[32];
+		unsigned int noise = rand();
+
+		for (int ii = 0; ii < 8; ++ii) {
+			generate_k(keys + ii * 32);
+			snowshoe_secret_gen(keys + ii * 32);
+		}
+
+		char saved[8 * 32];
+		memcpy(saved, keys, sizeof(keys));
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		int index = snowshoe_keygen_elligator(keys, 8, noise, P, R);
+		if (index < 0) {
+			// Expected about once in 256 tries
+			if (++failures > 200) {
+				cout << "keygen elligator failed" << endl;
+				return false;
+			}
+			continue;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		t.push_back(t1 - t0);
+		wall += s1 - s0;
+
+		// Check that the representative decodes to the public key
+		char P1[64], P2[64];
+		if (snowshoe_elligator_decode(R, P1)) {
+			cout << "elligator decode failed" << endl;
+			return false;
+		}
+
+		// Check that the keys were not modified
+		if (memcmp(keys, saved, sizeof(keys)) != 0) {
+			cout << "keygen elligator modified the keys" << endl;
+			return false;
+		}
+
+		// Check that the public key matches the private key
+		if (snowshoe_mul_gen(keys + index * 32, P2, 0)) {
+			cout << "keygen elligator mul_gen failed" << endl;
+			return false;
+		}
+
+		for (int ii = 0; ii < 64; ++ii) {
+			if (P[ii] != P1[ii] || P[ii] != P2[ii]) {
+				cout << "keygen elligator points do not match " << ii << endl;
+				return false;
+			}
+		}
+	}
+
+	u32 median = quick_select(&t[0], (int)t.size());
+	wall /= t.size();
+
+	cout << "+ Elligator keygen: `" << dec << median << "` median cycles, `" << wall << "` avg usec" << endl;
+
+	return true;
+}
+
+static bool ec_hash_to_curve_test() {
+	static const int N = 100;
+
+	vector<u32> t, tb;
+	double wall = 0, wb = 0;
+
+	char one[32] = {1};
+
+	for (int iteration = 0; iteration < 100; ++iteration) {
+		char h[64 * N], R[64 * N];
+
+		for (int ii = 0; ii < 2 * N; ++ii) {
+			generate_k(h + ii * 32);
+		}
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		if (snowshoe_hash_to_curve_batch(h, N, R)) {
+			cout << "hash to curve batch failed" << endl;
+			return false;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		tb.push_back((t1 - t0) / N);
+		wb += (s1 - s0) / N;
+
+		for (int ii = 0; ii < N; ++ii) {
+			char R1[64], R2[64], P0[64], P1[64];
+
+			s0 = m_clock.usec();
+			t0 = Clock::cycles();
+
+			if (snowshoe_hash_to_curve(h + ii * 64, R1)) {
+				cout << "hash to curve failed" << endl;
+				return false;
+			}
+
+			t1 = Clock::cycles();
+			s1 = m_clock.usec();
+
+			t.push_back(t1 - t0);
+			wall += s1 - s0;
+
+			// R2 = 4 * P0 + 4 * P1
+			if (snowshoe_elligator_decode(h + ii * 64, P0) ||
+				snowshoe_elligator_decode(h + ii * 64 + 32, P1) ||
+				snowshoe_simul(one, P0, one, P1, R2)) {
+				cout << "hash to curve reference failed" << endl;
+				return false;
+			}
+
+			for (int jj = 0; jj < 64; ++jj) {
+				if (R1[jj] != R2[jj] || R1[jj] != R[ii * 64 + jj]) {
+					cout << "hash to curve points do not match " << ii << endl;
+					return false;
+				}
+			}
+		}
+	}
+
+	u32 median = quick_select(&t[0], (int)t.size());
+	wall /= t.size();
+	u32 mb = quick_select(&tb[0], (int)tb.size());
+	wb /= tb.size();
+
+	cout << "+ Hash to curve: `" << dec << median << "` median cycles, `" << wall << "` avg usec" << endl;
+	cout << "+ Hash to curve batch: `" << dec << mb << "` median cycles, `" << wb << "` avg usec per hash" << endl;
+
+	return true;
+}
+
+static bool ec_soa_test() {
+	static const int N = 13;
+	static const int BLOCKS = (N + 7) / 8;
+
+	for (int iteration = 0; iteration < 100; ++iteration) {
+		char h[64 * N], R[64 * N], R2[64 * N];
+		char B[512 * BLOCKS], B2[512 * BLOCKS];
+
+		for (int ii = 0; ii < 2 * N; ++ii) {
+			generate_k(h + ii * 32);
+		}
+
+		if (snowshoe_hash_to_curve_batch(h, N, R) ||
+			snowshoe_hash_to_curve_batch_soa(h, N, B)) {
+			cout << "soa hash to curve failed" << endl;
+			return false;
+		}
+
+		if (snowshoe_valid_soa(B, N)) {
+			cout << "soa valid failed" << endl;
+			return false;
+		}
+
+		// Check both converters against the SoA output
+		memset(B2, 0xff, sizeof(B2));
+		snowshoe_xy_to_soa(R, N, B2);
+		snowshoe_soa_to_xy(B, N, R2);
+
+		if (memcmp(B, B2, sizeof(B)) != 0 || memcmp(R, R2, sizeof(R)) != 0) {
+			cout << "soa conversion mismatch" << endl;
+			return false;
+		}
+
+		// Invalidate one point
+		B[512 + 3] ^= 1;
+		if (!snowshoe_valid_soa(B, N)) {
+			cout << "soa valid accepted invalid point" << endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool ec_keydir_test() {
+	static const int N = 17;
+	vector<u32> tp, ts;
+	double wp = 0, ws = 0;
+
+	char ids[32 * N], P[64 * N];
+
+	for (int ii = 0; ii < N; ++ii) {
+		char k[32];
+
+		generate_k(ids + ii * 32);
+		generate_k(k);
+		snowshoe_secret_gen(k);
+
+		if (snowshoe_mul_gen(k, P + ii * 64, 0)) {
+			cout << "keydir keygen failed" << endl;
+			return false;
+		}
+	}
+
+	for (int prepared = 0; prepared < 2; ++prepared) {
+		const long long size = snowshoe_keydir_size(N, prepared);
+		vector<char> dir((size_t)size);
+
+		if (snowshoe_keydir_build(ids, P, N, prepared, &dir[0]) ||
+			snowshoe_keydir_open(&dir[0], size)) {
+			cout << "keydir build failed" << endl;
+			return false;
+		}
+
+		if (!snowshoe_keydir_open(&dir[0], size - 1)) {
+			cout << "keydir open accepted truncated directory" << endl;
+			return false;
+		}
+
+		for (int ii = 0; ii < N; ++ii) {
+			const char *entry = snowshoe_keydir_find(&dir[0], ids + ii * 32);
+
+			if (!entry || memcmp(entry + 32, P + ii * 64, 64) != 0) {
+				cout << "keydir find failed" << endl;
+				return false;
+			}
+
+			for (int iteration = 0; iteration < 500; ++iteration) {
+				char a[32], b[32], R[64], R2[64];
+
+				generate_k(a);
+				generate_k(b);
+				snowshoe_secret_gen(a);
+				snowshoe_secret_gen(b);
+
+				double s0 = m_clock.usec();
+				u32 t0 = Clock::cycles();
+
+				if (snowshoe_keydir_simul_gen(a, b, entry, R)) {
+					cout << "keydir simul gen failed" << endl;
+					return false;
+				}
+
+				u32 t1 = Clock::cycles();
+				double s1 = m_clock.usec();
+
+				if (prepared) {
+					tp.push_back(t1 - t0);
+					wp += s1 - s0;
+				}
+
+				s0 = m_clock.usec();
+				t0 = Clock::cycles();
+
+				if (snowshoe_simul_gen(a, b, P + ii * 64, R2)) {
+					return false;
+				}
+
+				t1 = Clock::cycles();
+				s1 = m_clock.usec();
+
+				ts.push_back(t1 - t0);
+				ws += s1 - s0;
+
+				if (memcmp(R, R2, 64) != 0) {
+					cout << "keydir simul gen mismatch" << endl;
+					return false;
+				}
+			}
+		}
+
+		// Missing id
+		char missing[32];
+		generate_k(missing);
+		if (snowshoe_keydir_find(&dir[0], missing)) {
+			cout << "keydir found missing id" << endl;
+			return false;
+		}
+
+		// Corrupt the point of the first record
+		dir[64 + 40] ^= 1;
+		if (!snowshoe_keydir_open(&dir[0], size)) {
+			cout << "keydir accepted corrupted entry" << endl;
+			return false;
+		}
+		dir[64 + 40] ^= 1;
+
+		// Corrupt the last byte of the table of the last record
+		if (prepared) {
+			dir[size - 1] ^= 1;
+			if (!snowshoe_keydir_open(&dir[0], size)) {
+				cout << "keydir accepted corrupted table" << endl;
+				return false;
+			}
+		}
+	}
+
+	// Repeated ids are rejected
+	memcpy(ids + 32, ids, 32);
+	vector<char> dir((size_t)snowshoe_keydir_size(N, 0));
+	if (!snowshoe_keydir_build(ids, P, N, 0, &dir[0])) {
+		cout << "keydir accepted repeated id" << endl;
+		return false;
+	}
+
+	// Negative counts are rejected
+	if (snowshoe_keydir_size(-1, 0) != -1 || snowshoe_keydir_size(-1, 1) != -1) {
+		cout << "keydir sized a negative count" << endl;
+		return false;
+	}
+
+	if (!snowshoe_keydir_build(ids, P, -1, 0, &dir[0])) {
+		cout << "keydir accepted a negative count" << endl;
+		return false;
+	}
+
+	u32 medp = quick_select(&tp[0], (int)tp.size());
+	u32 meds = quick_select(&ts[0], (int)ts.size());
+
+	cout << "+ ec_keydir_simul_gen (prepared): `" << dec << medp << "` median cycles, `" << wp / tp.size() << "` avg usec" << endl;
+	cout << "+ ec_simul_gen (reference): `" << dec << meds << "` median cycles, `" << ws / ts.size() << "` avg usec" << endl;
+
+	return true;
+}
+
+static bool ec_msm_test() {
+	static const int N = 1000;
+	vector<u32> t;
+	double w = 0;
+
+	vector<char> terms(96 * N);
+	char sum[32] = {0};
+
+	// Terms k_i * x_i * G so that the sum can be checked with one mul_gen
+	for (int ii = 0; ii < N; ++ii) {
+		char *k = &terms[ii * 96];
+		char x[32];
+
+		generate_k(k);
+		generate_k(x);
+		snowshoe_secret_gen(k);
+		snowshoe_secret_gen(x);
+
+		// Include a zero scalar
+		if (ii == 7) {
+			memset(k, 0, 32);
+		}
+
+		if (snowshoe_mul_gen(x, k + 32, 0)) {
+			cout << "msm keygen failed" << endl;
+			return false;
+		}
+
+		snowshoe_mul_mod_q(k, x, sum, sum);
+	}
+
+	char expected[64];
+	if (snowshoe_mul_gen(sum, expected, 1)) {
+		cout << "msm reference failed" << endl;
+		return false;
+	}
+
+	vector<char> a(snowshoe_msm_size()), b(snowshoe_msm_size());
+
+	// Stream the terms in chunks of 64
+	snowshoe_msm_init(&a[0]);
+	for (int ii = 0; ii < N; ii += 64) {
+		const int n = N - ii < 64 ? N - ii : 64;
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		if (snowshoe_msm_update(&a[0], &terms[ii * 96], n)) {
+			cout << "msm update failed" << endl;
+			return false;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		t.push_back((t1 - t0) / n);
+		w += (s1 - s0) / n;
+	}
+
+	char R[64];
+	snowshoe_msm_finish(&a[0], R);
+	if (memcmp(R, expected, 64) != 0) {
+		cout << "msm mismatch" << endl;
+		return false;
+	}
+
+	// Split the terms between two states and merge
+	snowshoe_msm_init(&a[0]);
+	snowshoe_msm_init(&b[0]);
+	if (snowshoe_msm_update(&a[0], &terms[0], 300) ||
+		snowshoe_msm_update(&b[0], &terms[300 * 96], 500) ||
+		snowshoe_msm_update(&a[0], &terms[800 * 96], N - 800)) {
+		cout << "msm update failed" << endl;
+		return false;
+	}
+
+	snowshoe_msm_merge(&a[0], &b[0]);
+	snowshoe_msm_finish(&a[0], R);
+	if (memcmp(R, expected, 64) != 0) {
+		cout << "msm merge mismatch" << endl;
+		return false;
+	}
+
+	// An invalid point leaves the state unchanged
+	terms[5 * 96 + 40] ^= 1;
+	if (!snowshoe_msm_update(&a[0], &terms[0], 10)) {
+		cout << "msm accepted invalid point" << endl;
+		return false;
+	}
+
+	snowshoe_msm_finish(&a[0], R);
+	if (memcmp(R, expected, 64) != 0) {
+		cout << "msm state changed by failed update" << endl;
+		return false;
+	}
+
+	u32 med = quick_select(&t[0], (int)t.size());
+
+	cout << "+ MSM update: `" << dec << med << "` median cycles, `" << w / t.size() << "` avg usec per term" << endl;
+
+	return true;
+}
+
+static bool ec_sig_aggregate_test() {
+	static const int N = 1024;
+	vector<u32> tv;
+	double wv = 0;
+
+	vector<char> z(32 * N), s(32 * N), t(32 * N), A(64 * N), R(64 * N);
+
+	for (int iteration = 0; iteration < 8; ++iteration) {
+		// A few signatures are summed in pairs, many in MSM buckets
+		const int n = iteration == 0 ? 1 : iteration == 1 ? 5 : N;
+
+		// Sign as in ec_dsa_test, with fake hashes
+		for (int ii = 0; ii < n; ++ii) {
+			char a[32], h[64];
+
+			generate_k(a);
+			snowshoe_secret_gen(a);
+			if (snowshoe_mul_gen(a, &A[ii * 64], 0)) {
+				return false;
+			}
+
+			char r[32];
+			generate_k(h);
+			generate_k(h + 32);
+			snowshoe_mod_q(h, r);
+			if (snowshoe_mul_gen(r, &R[ii * 64], 1)) {
+				return false;
+			}
+
+			generate_k(h);
+			generate_k(h + 32);
+			snowshoe_mod_q(h, &t[ii * 32]);
+			snowshoe_mul_mod_q(a, &t[ii * 32], r, &s[ii * 32]);
+
+			generate_k(h);
+			generate_k(h + 32);
+			snowshoe_mod_q(h, &z[ii * 32]);
+		}
+
+		char S[32];
+		snowshoe_sig_aggregate(&z[0], &s[0], n, S);
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		if (snowshoe_sig_verify_aggregate(&z[0], &t[0], &A[0], &R[0], n, S)) {
+			cout << "aggregate signature rejected" << endl;
+			return false;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		if (n == N) {
+			tv.push_back(t1 - t0);
+			wv += s1 - s0;
+		}
+
+		// Tamper with each input in turn
+		const int victim = iteration % n;
+
+		S[0] ^= 1;
+		if (!snowshoe_sig_verify_aggregate(&z[0], &t[0], &A[0], &R[0], n, S)) {
+			cout << "aggregate accepted a bad S" << endl;
+			return false;
+		}
+		S[0] ^= 1;
+
+		t[victim * 32] ^= 1;
+		if (!snowshoe_sig_verify_aggregate(&z[0], &t[0], &A[0], &R[0], n, S)) {
+			cout << "aggregate accepted a bad t" << endl;
+			return false;
+		}
+		t[victim * 32] ^= 1;
+
+		z[victim * 32] ^= 1;
+		if (!snowshoe_sig_verify_aggregate(&z[0], &t[0], &A[0], &R[0], n, S)) {
+			cout << "aggregate accepted a bad z" << endl;
+			return false;
+		}
+		z[victim * 32] ^= 1;
+
+		if (n > 1) {
+			char T[64];
+			memcpy(T, &R[0], 64);
+			memcpy(&R[0], &R[64], 64);
+			memcpy(&R[64], T, 64);
+			if (!snowshoe_sig_verify_aggregate(&z[0], &t[0], &A[0], &R[0], n, S)) {
+				cout << "aggregate accepted swapped R" << endl;
+				return false;
+			}
+		}
+
+		A[victim * 64] ^= 1;
+		if (!snowshoe_sig_verify_aggregate(&z[0], &t[0], &A[0], &R[0], n, S)) {
+			cout << "aggregate accepted an invalid point" << endl;
+			return false;
+		}
+	}
+
+	u32 mv = quick_select(&tv[0], (int)tv.size());
+	wv /= tv.size();
+
+	cout << "+ Aggregate verify (" << N << " signatures): `" << dec << mv / N << "` median cycles, `" << wv / N << "` avg usec per signature" << endl;
+
+	return true;
+}
+
+// Hash value stand-in: Reduce 64 random bytes mod q
+static void generate_h(char h[32]) {
+	char w[64];
+	generate_k(w);
+	generate_k(w + 32);
+	snowshoe_mod_q(w, h);
+}
+
+static bool ec_musig_test() {
+	static const int N = 7;
+	vector<u32> tc, ts;
+	double wc = 0, ws = 0;
+
+	char a[N][32], A[N * 64], c[N * 32], r[N][64], NN[N * 128], s[N * 32];
+	char X[64], nX[64], NA[128], b[32], R[64], t[32], S[32], Rtest[64];
+
+	for (int iteration = 0; iteration < 200; ++iteration) {
+		const int n = 1 + iteration % N;
+
+		// Key setup
+		for (int ii = 0; ii < n; ++ii) {
+			generate_k(a[ii]);
+			snowshoe_secret_gen(a[ii]);
+			if (snowshoe_mul_gen(a[ii], A + ii * 64, 0)) {
+				return false;
+			}
+
+			generate_h(c + ii * 32);
+		}
+
+		if (snowshoe_musig_key(c, A, n, X)) {
+			cout << "musig_key failed" << endl;
+			return false;
+		}
+
+		// Round 1
+		for (int ii = 0; ii < n; ++ii) {
+			generate_k(r[ii]);
+			generate_k(r[ii] + 32);
+			snowshoe_secret_gen(r[ii]);
+			snowshoe_secret_gen(r[ii] + 32);
+			if (snowshoe_musig_nonce(r[ii], NN + ii * 128)) {
+				return false;
+			}
+		}
+
+		// Round 2
+		if (snowshoe_musig_nonce_agg(NN, n, NA)) {
+			return false;
+		}
+
+		generate_h(b);
+		if (snowshoe_musig_nonce_final(NA, b, R)) {
+			return false;
+		}
+
+		generate_h(t);
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		if (snowshoe_musig_sign(a[0], c, r[0], b, t, s)) {
+			return false;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		ts.push_back(t1 - t0);
+		ws += s1 - s0;
+
+		for (int ii = 1; ii < n; ++ii) {
+			if (snowshoe_musig_sign(a[ii], c + ii * 32, r[ii], b, t, s + ii * 32)) {
+				return false;
+			}
+		}
+
+		for (int ii = 0; ii < n; ++ii) {
+			if (snowshoe_musig_verify_partial(A + ii * 64, c + ii * 32, NN + ii * 128, b, t, s + ii * 32)) {
+				cout << "partial signature " << ii << " rejected" << endl;
+				return false;
+			}
+		}
+
+		snowshoe_musig_combine(s, n, S);
+
+		// Verify as a single signature
+		s0 = m_clock.usec();
+		t0 = Clock::cycles();
+
+		snowshoe_neg(X, nX);
+		if (snowshoe_simul_gen(S, t, nX, Rtest)) {
+			return false;
+		}
+
+		t1 = Clock::cycles();
+		s1 = m_clock.usec();
+
+		tc.push_back(t1 - t0);
+		wc += s1 - s0;
+
+		if (memcmp(Rtest, R, 64) != 0) {
+			cout << "musig signature rejected with " << n << " signers" << endl;
+			return false;
+		}
+
+		// A bad partial signature is caught and breaks the signature
+		const int victim = iteration % n;
+		s[victim * 32] ^= 1;
+
+		if (!snowshoe_musig_verify_partial(A + victim * 64, c + victim * 32, NN + victim * 128, b, t, s + victim * 32)) {
+			cout << "bad partial signature accepted" << endl;
+			return false;
+		}
+
+		snowshoe_musig_combine(s, n, S);
+		if (snowshoe_simul_gen(S, t, nX, Rtest) == 0 && memcmp(Rtest, R, 64) == 0) {
+			cout << "bad musig signature accepted" << endl;
+			return false;
+		}
+	}
+
+	u32 mc = quick_select(&tc[0], (int)tc.size());
+	wc /= tc.size();
+	u32 ms = quick_select(&ts[0], (int)ts.size());
+	ws /= ts.size();
+
+	cout << "+ MuSig partial sign: `" << dec << ms << "` median cycles, `" << ws << "` avg usec" << endl;
+	cout << "+ MuSig verify (1-" << N << " signers): `" << dec << mc << "` median cycles, `" << wc << "` avg usec" << endl;
+
+	return true;
+}
+
+static bool ec_commit_test() {
+	static const int N = 100;
+	static const u8 PI[64] = {
+		0x24, 0x3F, 0x6A, 0x88, 0x85, 0xA3, 0x08, 0xD3, 0x13, 0x19, 0x8A, 0x2E, 0x03, 0x70, 0x73, 0x44,
+		0xA4, 0x09, 0x38, 0x22, 0x29, 0x9F, 0x31, 0xD0, 0x08, 0x2E, 0xFA, 0x98, 0xEC, 0x4E, 0x6C, 0x89,
+		0x45, 0x28, 0x21, 0xE6, 0x38, 0xD0, 0x13, 0x77, 0xBE, 0x54, 0x66, 0xCF, 0x34, 0xE9, 0x0C, 0x6C,
+		0xC0, 0xAC, 0x29, 0xB7, 0xC9, 0x7C, 0x50, 0xDD, 0x3F, 0x84, 0xD5, 0xB5, 0xB5, 0x47, 0x09, 0x17
+	};
+
+	vector<u32> t;
+	double w = 0;
+
+	char H[64], four[32] = { 4 };
+	if (snowshoe_hash_to_curve((const char *)PI, H)) {
+		return false;
+	}
+
+	char k[N * 32], r[N * 32], C[N * 64], k4[32], r4[32], D[64], E[N * 64];
+
+	for (int ii = 0; ii < N; ++ii) {
+		generate_k(k + ii * 32);
+		generate_k(r + ii * 32);
+		snowshoe_secret_gen(k + ii * 32);
+		snowshoe_secret_gen(r + ii * 32);
+	}
+
+	// Zero values are allowed
+	memset(k, 0, 32);
+
+	for (int ii = 0; ii < N; ++ii) {
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		if (snowshoe_commit(k + ii * 32, r + ii * 32, C + ii * 64)) {
+			return false;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		t.push_back(t1 - t0);
+		w += s1 - s0;
+
+		// 4 * C = 4kG + 4rH
+		snowshoe_mul_mod_q(k + ii * 32, four, 0, k4);
+		snowshoe_mul_mod_q(r + ii * 32, four, 0, r4);
+		if (snowshoe_commit(k4, r4, D)) {
+			return false;
+		}
+
+		char E1[64];
+		if (ii == 0) {
+			if (snowshoe_mul(r, H, E1)) {
+				return false;
+			}
+		} else if (snowshoe_simul_gen(k + ii * 32, r + ii * 32, H, E1)) {
+			return false;
+		}
+
+		if (memcmp(D, E1, 64) != 0) {
+			cout << "commitment " << ii << " does not match" << endl;
+			return false;
+		}
+	}
+
+	u32 med = quick_select(&t[0], (int)t.size());
+	w /= t.size();
+
+	cout << "+ Commit: `" << dec << med << "` median cycles, `" << w << "` avg usec" << endl;
+
+	// Batch matches one at a time across several chunks
+	double s0 = m_clock.usec();
+
+	if (snowshoe_commit_batch(k, r, N, E)) {
+		return false;
+	}
+
+	double s1 = m_clock.usec();
+
+	if (memcmp(C, E, sizeof(C)) != 0) {
+		cout << "batch commitments do not match" << endl;
+		return false;
+	}
+
+	cout << "+ Commit batch: `" << (s1 - s0) / N << "` avg usec per commitment" << endl;
+
+	// Zero blinding and k >= q are rejected, and the batch writes nothing
+	char zero[32] = { 0 }, big[32];
+	memset(big, 0xFF, sizeof(big));
+
+	if (!snowshoe_commit(k + 32, zero, D) || !snowshoe_commit(big, r, D)) {
+		return false;
+	}
+
+	memset(E, 0, sizeof(E));
+	memcpy(r + (N - 1) * 32, zero, 32);
+	if (!snowshoe_commit_batch(k, r, N, E)) {
+		return false;
+	}
+
+	for (int ii = 0; ii < (int)sizeof(E); ++ii) {
+		if (E[ii] != 0) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool ec_pool_test() {
+	static const int N = 256;
+
+	snowshoe_pool *pool = snowshoe_pool_create(4, SNOWSHOE_POOL_PIN);
+	if (!pool || snowshoe_pool_threads(pool) != 4) {
+		cout << "pool create failed" << endl;
+		return false;
+	}
+
+	vector<char> a(32 * N), b(32 * N), P(64 * N), R(64 * N), E(128 * N);
+	char expected[128];
+
+	for (int ii = 0; ii < N; ++ii) {
+		generate_k(&a[ii * 32]);
+		generate_k(&b[ii * 32]);
+		snowshoe_secret_gen(&a[ii * 32]);
+		snowshoe_secret_gen(&b[ii * 32]);
+	}
+
+	// One invalid scalar
+	memset(&a[9 * 32], 0, 32);
+
+	double s0 = m_clock.usec();
+	if (!snowshoe_pool_mul_gen(pool, &a[0], N, &P[0], 0)) {
+		cout << "pool mul gen accepted invalid scalar" << endl;
+		return false;
+	}
+	double s1 = m_clock.usec();
+
+	for (int ii = 0; ii < N; ++ii) {
+		if (snowshoe_mul_gen(&a[ii * 32], expected, 0)) {
+			memset(expected, 0, 64);
+		}
+
+		if (memcmp(&P[ii * 64], expected, 64) != 0) {
+			cout << "pool mul gen mismatch" << endl;
+			return false;
+		}
+	}
+
+	// Make the invalid entry valid again
+	memcpy(&P[9 * 64], &P[10 * 64], 64);
+	a[9 * 32] = 1;
+
+	double s2 = m_clock.usec();
+	if (snowshoe_pool_mul(pool, &b[0], &P[0], N, &R[0])) {
+		cout << "pool mul failed" << endl;
+		return false;
+	}
+	double s3 = m_clock.usec();
+
+	for (int ii = 0; ii < N; ++ii) {
+		if (snowshoe_mul(&b[ii * 32], &P[ii * 64], expected) ||
+			memcmp(&R[ii * 64], expected, 64) != 0) {
+			cout << "pool mul mismatch" << endl;
+			return false;
+		}
+	}
+
+	if (snowshoe_pool_simul_gen(pool, &a[0], &b[0], &P[0], N, &R[0])) {
+		cout << "pool simul gen failed" << endl;
+		return false;
+	}
+
+	for (int ii = 0; ii < N; ++ii) {
+		if (snowshoe_simul_gen(&a[ii * 32], &b[ii * 32], &P[ii * 64], expected) ||
+			memcmp(&R[ii * 64], expected, 64) != 0) {
+			cout << "pool simul gen mismatch" << endl;
+			return false;
+		}
+	}
+
+	if (snowshoe_pool_elligator(pool, &a[0], N, &E[0])) {
+		cout << "pool elligator failed" << endl;
+		return false;
+	}
+
+	for (int ii = 0; ii < N; ++ii) {
+		if (snowshoe_elligator(&a[ii * 32], expected) ||
+			memcmp(&E[ii * 128], expected, 128) != 0) {
+			cout << "pool elligator mismatch" << endl;
+			return false;
+		}
+	}
+
+	// MSM with more chunks than workers
+	static const int M = 20000;
+	vector<char> terms(96 * M), state(snowshoe_msm_size());
+	for (int ii = 0; ii < M; ++ii) {
+		generate_k(&terms[ii * 96]);
+		memcpy(&terms[ii * 96 + 32], &P[(ii % N) * 64], 64);
+	}
+
+	char sum[64];
+	snowshoe_msm_init(&state[0]);
+	if (snowshoe_msm_update(&state[0], &terms[0], M) ||
+		snowshoe_pool_msm(pool, &terms[0], M, R.data())) {
+		cout << "pool msm failed" << endl;
+		return false;
+	}
+	snowshoe_msm_finish(&state[0], sum);
+
+	if (memcmp(&R[0], sum, 64) != 0) {
+		cout << "pool msm mismatch" << endl;
+		return false;
+	}
+
+	// Negative counts are rejected
+	if (!snowshoe_pool_mul_gen(pool, &a[0], -1, &P[0], 0) ||
+		!snowshoe_pool_mul(pool, &b[0], &P[0], -1, &R[0]) ||
+		!snowshoe_pool_simul_gen(pool, &a[0], &b[0], &P[0], -1, &R[0]) ||
+		!snowshoe_pool_elligator(pool, &a[0], -1, &E[0]) ||
+		!snowshoe_pool_msm(pool, &terms[0], -1, R.data())) {
+		cout << "pool accepted negative count" << endl;
+		return false;
+	}
+
+	snowshoe_pool_free(pool);
+
+	cout << "+ Pool mul gen (4 threads): `" << (s1 - s0) / N << "` avg usec per call" << endl;
+	cout << "+ Pool mul (4 threads): `" << (s3 - s2) / N << "` avg usec per call" << endl;
+
+	return true;
+}
+
+static bool ec_ring_test() {
+	static const int N = 200;
+
+	snowshoe_ring *ring = snowshoe_ring_create(64, 2);
+	if (!ring) {
+		cout << "ring create failed" << endl;
+		return false;
+	}
+
+	vector<char> a(32 * N), b(32 * N), P(64 * N), R(128 * N);
+	vector<snowshoe_op> ops(N);
+
+	for (int ii = 0; ii < N; ++ii) {
+		generate_k(&a[ii * 32]);
+		generate_k(&b[ii * 32]);
+		snowshoe_secret_gen(&a[ii * 32]);
+		snowshoe_secret_gen(&b[ii * 32]);
+
+		if (snowshoe_mul_gen(&b[ii * 32], &P[ii * 64], 0)) {
+			return false;
+		}
+
+		snowshoe_op &op = ops[ii];
+		memset(&op, 0, sizeof(op));
+		op.tag = ii;
+		op.op = SNOWSHOE_OP_MUL_GEN + ii % 5;
+		op.a = &a[ii * 32];
+		op.b = &b[ii * 32];
+		op.P = &P[ii * 64];
+		op.Q = &P[((ii + 1) % N) * 64];
+		op.R = &R[ii * 128];
+	}
+
+	// One invalid operation, and one invalid Elligator key in a batch
+	memset(&a[13 * 32], 0, 32);
+	memset(&a[14 * 32], 0, 32);
+
+	if (snowshoe_ring_submit(ring, &ops[0], -1) != -1) {
+		cout << "ring accepted negative count" << endl;
+		return false;
+	}
+
+	vector<int> results(N, 1);
+	int submitted = 0, completed = 0;
+
+	while (completed < N) {
+		submitted += snowshoe_ring_submit(ring, &ops[submitted], N - submitted);
+
+#ifdef __linux__
+		pollfd pfd;
+		pfd.fd = snowshoe_ring_fd(ring);
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, 10000) != 1) {
+			cout << "ring poll timed out" << endl;
+			return false;
+		}
+#endif
+
+		snowshoe_completion done[16];
+		const int n = snowshoe_ring_complete(ring, done, 16);
+
+		for (int ii = 0; ii < n; ++ii) {
+			if (done[ii].tag >= (unsigned)N || results[done[ii].tag] != 1) {
+				cout << "ring bad completion" << endl;
+				return false;
+			}
+
+			results[done[ii].tag] = done[ii].result;
+		}
+
+		completed += n;
+	}
+
+	snowshoe_ring_free(ring);
+
+	for (int ii = 0; ii < N; ++ii) {
+		const snowshoe_op &op = ops[ii];
+		char expected[128];
+		int r = -1;
+
+		switch (op.op) {
+		case SNOWSHOE_OP_MUL_GEN: r = snowshoe_mul_gen(op.a, expected, 0); break;
+		case SNOWSHOE_OP_MUL: r = snowshoe_mul(op.a, op.P, expected); break;
+		case SNOWSHOE_OP_SIMUL_GEN: r = snowshoe_simul_gen(op.a, op.b, op.Q, expected); break;
+		case SNOWSHOE_OP_SIMUL: r = snowshoe_simul(op.a, op.P, op.b, op.Q, expected); break;
+		case SNOWSHOE_OP_ELLIGATOR: r = snowshoe_elligator(op.a, expected); break;
+		}
+
+		const int bytes = op.op == SNOWSHOE_OP_ELLIGATOR ? 128 : 64;
+
+		if ((r != 0) != (results[ii] != 0) || (r == 0 && memcmp(op.R, expected, bytes) != 0)) {
+			cout << "ring result mismatch" << endl;
+			return false;
+		}
+	}
+
+	if (results[13] == 0 || results[14] == 0) {
+		cout << "ring accepted invalid operation" << endl;
+		return false;
+	}
+
+	return true;
+}
+
+static bool ec_coalescer_test() {
+	static const int THREADS = 8;
+	static const int CALLS = 40;
+
+	snowshoe_coalescer *c = snowshoe_coalescer_create(200, 8);
+	if (!c) {
+		cout << "coalescer create failed" << endl;
+		return false;
+	}
+
+	// Inputs are generated up front since rand() is not thread-safe
+	static const int N = THREADS * CALLS;
+	vector<char> a(32 * N), b(32 * N), P(64 * N), R(128 * N), expected(128 * N);
+	vector<int> results(N), expected_results(N);
+
+	for (int ii = 0; ii < N; ++ii) {
+		generate_k(&a[ii * 32]);
+		generate_k(&b[ii * 32]);
+		snowshoe_secret_gen(&a[ii * 32]);
+		snowshoe_secret_gen(&b[ii * 32]);
+
+		if (snowshoe_mul_gen(&b[ii * 32], &P[ii * 64], 0)) {
+			return false;
+		}
+	}
+
+	// One invalid call
+	memset(&a[77 * 32], 0, 32);
+
+	for (int ii = 0; ii < N; ++ii) {
+		const char *k = &a[ii * 32];
+		char *r = &expected[ii * 128];
+
+		switch (ii % 4) {
+		case 0: expected_results[ii] = snowshoe_mul_gen(k, r, ii & 4); break;
+		case 1: expected_results[ii] = snowshoe_mul(k, &P[ii * 64], r); break;
+		case 2: expected_results[ii] = snowshoe_simul_gen(k, &b[ii * 32], &P[ii * 64], r); break;
+		case 3: expected_results[ii] = snowshoe_elligator(k, r); break;
+		}
+	}
+
+	vector<thread> threads;
+	double s0 = m_clock.usec();
+
+	for (int t = 0; t < THREADS; ++t) {
+		threads.push_back(thread([&, t] {
+			for (int jj = 0; jj < CALLS; ++jj) {
+				const int ii = jj * THREADS + t;
+				const char *k = &a[ii * 32];
+				char *r = &R[ii * 128];
+
+				switch (ii % 4) {
+				case 0: results[ii] = snowshoe_coalesced_mul_gen(c, k, r, ii & 4); break;
+				case 1: results[ii] = snowshoe_coalesced_mul(c, k, &P[ii * 64], r); break;
+				case 2: results[ii] = snowshoe_coalesced_simul_gen(c, k, &b[ii * 32], &P[ii * 64], r); break;
+				case 3: results[ii] = snowshoe_coalesced_elligator(c, k, r); break;
+				}
+			}
+		}));
+	}
+
+	for (int t = 0; t < THREADS; ++t) {
+		threads[t].join();
+	}
+
+	double s1 = m_clock.usec();
+
+	snowshoe_coalescer_free(c);
+
+	for (int ii = 0; ii < N; ++ii) {
+		const int bytes = ii % 4 == 3 ? 128 : 64;
+
+		if (results[ii] != expected_results[ii] ||
+			(results[ii] == 0 && memcmp(&R[ii * 128], &expected[ii * 128], bytes) != 0)) {
+			cout << "coalescer result mismatch" << endl;
+			return false;
+		}
+	}
+
+	if (results[77] == 0) {
+		cout << "coalescer accepted invalid call" << endl;
+		return false;
+	}
+
+	cout << "+ Coalesced calls (8 threads): `" << (s1 - s0) / N << "` avg usec per call" << endl;
+
+	return true;
+}
+
+static bool ec_elligator_prepared_test() {
+	vector<u32> tp, ts;
+	double wp = 0, ws = 0;
+
+	for (int iteration = 0; iteration < 10000; ++iteration) {
+		char key[32], E[128];
+
+		generate_k(key);
+
+		if (snowshoe_elligator(key, E)) {
+			cout << "elligator failed" << endl;
+			return false;
+		}
+
+		// Verifier point
+		char v[32], V[64];
+
+		generate_k(v);
+		snowshoe_secret_gen(v);
+
+		if (snowshoe_mul_gen(v, V, 0)) {
+			cout << "elligator prepared mul_gen failed" << endl;
+			return false;
+		}
+
+		char x[32], X[64];
+
+		generate_k(x);
+		snowshoe_secret_gen(x);
+
+		if (snowshoe_elligator_encrypt(x, E, X)) {
+			cout << "elligator prepared encrypt failed" << endl;
+			return false;
+		}
+
+		char y[32], b[32];
+
+		generate_k(y);
+		snowshoe_secret_gen(y);
+		generate_k(b);
+		snowshoe_secret_gen(b);
+
+		char P[384];
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		if (snowshoe_elligator_prepare(E, V, P)) {
+			cout << "elligator prepare failed" << endl;
+			return false;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		tp.push_back(t1 - t0);
+		wp += s1 - s0;
+
+		char Z1[64], Z2[64];
+
+		s0 = m_clock.usec();
+		t0 = Clock::cycles();
+
+		if (snowshoe_elligator_secret_prepared(y, X, P, b, Z1)) {
+			cout << "elligator secret prepared failed" << endl;
+			return false;
+		}
+
+		t1 = Clock::cycles();
+		s1 = m_clock.usec();
+
+		ts.push_back(t1 - t0);
+		ws += s1 - s0;
+
+		if (snowshoe_elligator_secret(y, X, E, b, V, Z2)) {
+			cout << "elligator secret failed" << endl;
+			return false;
+		}
+
+		for (int ii = 0; ii < 64; ++ii) {
+			if (Z1[ii] != Z2[ii]) {
+				cout << "elligator prepared result points do not match " << ii << endl;
+				return false;
+			}
+		}
+
+		// Without the V term
+		if (snowshoe_elligator_secret_prepared(y, X, P, 0, Z1) ||
+			snowshoe_elligator_secret(y, X, E, 0, 0, Z2)) {
+			cout << "elligator secret without V failed" << endl;
+			return false;
+		}
+
+		for (int ii = 0; ii < 64; ++ii) {
+			if (Z1[ii] != Z2[ii]) {
+				cout << "elligator prepared result points without V do not match " << ii << endl;
+				return false;
+			}
+		}
+	}
+
+	u32 mp = quick_select(&tp[0], (int)tp.size());
+	wp /= tp.size();
+	u32 ms = quick_select(&ts[0], (int)ts.size());
+	ws /= ts.size();
+
+	cout << "+ Elligator prepare: `" << dec << mp << "` median cycles, `" << wp << "` avg usec" << endl;
+	cout << "+ Elligator secret prepared: `" << dec << ms << "` median cycles, `" << ws << "` avg usec" << endl;
+
+	return true;
+}
+
+static bool ec_short_test() {
+	vector<u32> tm, ts;
+	double wm = 0, ws = 0;
+
+	for (int iteration = 0; iteration < 10000; ++iteration) {
+		char a[32], b[32], P[64], Q[64];
+
+		generate_k(a);
+		snowshoe_secret_gen(a);
+		generate_k(b);
+		snowshoe_secret_gen(b);
+
+		if (snowshoe_mul_gen(a, P, 0) || snowshoe_mul_gen(b, Q, 0)) {
+			cout << "short mul_gen failed" << endl;
+			return false;
+		}
+
+		// Short scalars with nonzero s0 of either parity, with the extremes mixed in
+		char sa[32], sb[32];
+
+		generate_k(sa);
+		generate_k(sb);
+		sa[1] |= 1;
+		sb[1] |= 1;
+		if (iteration < 2) {
+			memset(sa, 0xff, 16);
+			memset(sb + 8, iteration ? 0xff : 0, 8);
+		} else if (iteration < 4) {
+			// Even s0: 2 and 2^64 - 2
+			memset(sa, iteration == 2 ? 0 : 0xff, 8);
+			sa[0] = iteration == 2 ? 2 : (char)0xfe;
+			memcpy(sb, sa, 8);
+		}
+
+		char ka[32], kb[32];
+
+		if (snowshoe_short_scalar(sa, ka) || snowshoe_short_scalar(sb, kb)) {
+			cout << "short scalar failed" << endl;
+			return false;
+		}
+
+		char R1[64], R2[64];
+
+		double s0 = m_clock.usec();
+		u32 t0 = Clock::cycles();
+
+		if (snowshoe_mul_short(sa, P, R1)) {
+			cout << "mul short failed" << endl;
+			return false;
+		}
+
+		u32 t1 = Clock::cycles();
+		double s1 = m_clock.usec();
+
+		tm.push_back(t1 - t0);
+		wm += s1 - s0;
+
+		if (snowshoe_mul(ka, P, R2)) {
+			cout << "short reference mul failed" << endl;
+			return false;
+		}
+
+		if (memcmp(R1, R2, 64) != 0) {
+			cout << "mul short result does not match" << endl;
+			return false;
+		}
+
+		s0 = m_clock.usec();
+		t0 = Clock::cycles();
+
+		if (snowshoe_simul_short(sa, P, sb, Q, R1)) {
+			cout << "simul short failed" << endl;
+			return false;
+		}
+
+		t1 = Clock::cycles();
+		s1 = m_clock.usec();
+
+		ts.push_back(t1 - t0);
+		ws += s1 - s0;
+
+		if (snowshoe_simul(ka, P, kb, Q, R2)) {
+			cout << "short reference simul failed" << endl;
+			return false;
+		}
+
+		if (memcmp(R1, R2, 64) != 0) {
+			cout << "simul short result does not match" << endl;
+			return false;
+		}
+	}
+
+	// s0 = 0 is rejected
+	char s[16] = {0}, k[32], P[64], R[64];
+
+	s[8] = 1;
+	generate_k(k);
+	snowshoe_secret_gen(k);
+	snowshoe_mul_gen(k, P, 0);
+
+	if (!snowshoe_short_scalar(s, k) ||
+		!snowshoe_mul_short(s, P, R) ||
+		!snowshoe_simul_short(s, P, s, P, R)) {
+		cout << "short scalar with s0 = 0 was accepted" << endl;
+		return false;
+	}
+
+	u32 mm = quick_select(&tm[0], (int)tm.size());
+	wm /= tm.size();
+	u32 ms = quick_select(&ts[0], (int)ts.size());
+	ws /= ts.size();
+
+	cout << "+ Short mul: `" << dec << mm << "` median cycles, `" << wm << "` avg usec" << endl;
+	cout << "+ Short simul: `" << dec << ms << "` median cycles, `" << ws << "` avg usec" << endl;
+
+	return true;
+}
+
+static bool ec_counts_test() {
+	snowshoe_counts c0, c1;
+
+#ifdef CAT_SNOWSHOE_COUNT_OPS
+	char k[32], R[64];
+
+	generate_k(k);
+	snowshoe_secret_gen(k);
+
+	if (snowshoe_counts_snapshot(&c0)) {
+		cout << "counts snapshot failed" << endl;
+		return false;
+	}
+
+	if (snowshoe_mul_gen(k, R, 1)) {
+		cout << "counts mul_gen failed" << endl;
+		return false;
+	}
+
+	snowshoe_counts_snapshot(&c1);
+
+	// One inversion for the affine result and two doublings for the cofactor
+	const unsigned long long inv = c1.fe_inv - c0.fe_inv;
+	const unsigned long long dbl = c1.ec_dbl - c0.ec_dbl;
+	const unsigned long long add = c1.ec_add - c0.ec_add;
+
+	if (inv != 1 || dbl < 2 || add == 0 || c1.fp_inv != c0.fp_inv) {
+		cout << "counts do not match mul_gen" << endl;
+		return false;
+	}
+
+	// Known costs of mul_gen, with the Fp steps of Fp^2 operations hidden
+	if (c1.fe_mul - c0.fe_mul != 400 || c1.fe_sqr - c0.fe_sqr != 28 ||
+		c1.fe_add - c0.fe_add != 343 || add != 42 || dbl != 7 ||
+		c1.fp_mul != c0.fp_mul || c1.fp_sqr != c0.fp_sqr) {
+		cout << "counts do not match mul_gen costs" << endl;
+		return false;
+	}
+
+	cout << "+ mul_gen counts: " << c1.fe_mul - c0.fe_mul << "M " << c1.fe_sqr - c0.fe_sqr << "S "
+		<< c1.fe_add - c0.fe_add << "A " << inv << "I, " << add << " adds " << dbl << " dbls" << endl;
+#else
+	// Not built in, so the snapshot fails and reads as zero
+	if (snowshoe_counts_snapshot(&c0) != -1 || c0.fe_mul != 0) {
+		cout << "counts snapshot should fail" << endl;
+		return false;
+	}
+	(void)c1;
+#endif
+
+	return true;
+}
+
+
+static bool ec_stats_test() {
+	// Bucket bounds must increase and names must exist
+	for (int ii = 1; ii < SNOWSHOE_STATS_BUCKETS; ++ii) {
+		if (snowshoe_stats_bucket_ns(ii) <= snowshoe_stats_bucket_ns(ii - 1)) {
+			cout << "stats buckets out of order at " << ii << endl;
+			return false;
+		}
+	}
+	for (int ii = 0; ii < SNOWSHOE_STAT_COUNT; ++ii) {
+		if (!snowshoe_stats_name(ii)) {
+			cout << "stats name missing for " << ii << endl;
+			return false;
+		}
+	}
+
+	// Two snapshots are needed below, and they are large
+	vector<snowshoe_stats> snap(2);
+
+#ifdef CAT_SNOWSHOE_STATS
+	char k[32], P[64], R[64], ids[64], dir[4096];
+
+	generate_k(k);
+	snowshoe_secret_gen(k);
+	snowshoe_mul_gen(k, P, 0);
+	generate_k(ids);
+	generate_k(ids + 32);
+
+	if (snowshoe_keydir_size(1, 0) > (long long)sizeof(dir) ||
+		snowshoe_keydir_build(ids, P, 1, 0, dir)) {
+		cout << "stats keydir build failed" << endl;
+		return false;
+	}
+
+	snowshoe_stats_enable(1);
+
+	if (snowshoe_stats_snapshot(&snap[0])) {
+		cout << "stats snapshot failed" << endl;
+		return false;
+	}
+
+	for (int ii = 0; ii < 10; ++ii) {
+		snowshoe_mul_gen(k, R, 0);
+	}
+
+	snowshoe_keydir_find(dir, ids);
+	snowshoe_keydir_find(dir, ids + 32);
+
+	// Calls from a thread that has exited must still count
+	thread t([&] {
+		char R2[64];
+		snowshoe_mul(k, P, R2);
+		snowshoe_elligator_batch(ids, 2, dir + 2048);
+	});
+	t.join();
+
+	snowshoe_stats_snapshot(&snap[1]);
+	snowshoe_stats_enable(0);
+
+	const snowshoe_stats_op &mul_gen = snap[1].ops[SNOWSHOE_STAT_MUL_GEN];
+	const snowshoe_stats_op &mul_gen0 = snap[0].ops[SNOWSHOE_STAT_MUL_GEN];
+
+	unsigned long long sum = 0;
+	for (int ii = 0; ii < SNOWSHOE_STATS_BUCKETS; ++ii) {
+		sum += mul_gen.histogram[ii] - mul_gen0.histogram[ii];
+	}
+
+	if (mul_gen.calls - mul_gen0.calls != 10 || sum != 10 ||
+		mul_gen.total_ns <= mul_gen0.total_ns) {
+		cout << "stats mul_gen counts do not match" << endl;
+		return false;
+	}
+
+	if (snap[1].keydir_hits - snap[0].keydir_hits != 1 ||
+		snap[1].keydir_misses - snap[0].keydir_misses != 1) {
+		cout << "stats keydir counts do not match" << endl;
+		return false;
+	}
+
+	if (snap[1].ops[SNOWSHOE_STAT_MUL].calls - snap[0].ops[SNOWSHOE_STAT_MUL].calls != 1 ||
+		snap[1].ops[SNOWSHOE_STAT_ELLIGATOR_BATCH].items - snap[0].ops[SNOWSHOE_STAT_ELLIGATOR_BATCH].items != 2) {
+		cout << "stats from an exited thread are missing" << endl;
+		return false;
+	}
+
+	cout << "+ Stats mul_gen: `" << (mul_gen.total_ns - mul_gen0.total_ns) / 10 << "` avg nsec" << endl;
+
+	// Not counted while disabled
+	snowshoe_mul_gen(k, R, 0);
+	snowshoe_stats_snapshot(&snap[0]);
+
+	if (snap[0].ops[SNOWSHOE_STAT_MUL_GEN].calls != mul_gen.calls) {
+		cout << "stats counted while disabled" << endl;
+		return false;
+	}
+
+#else
+	// Not built in, so the snapshot fails and reads as zero
+	if (snowshoe_stats_snapshot(&snap[0]) != -1 || snap[0].ops[0].calls != 0) {
+		cout << "stats snapshot should fail" << endl;
+		return false;
+	}
+#endif
+
+	return true;
+}
+
+
 //// Entrypoint
 
 static void tscTime() {
@@ -538,6 +2099,22 @@ int main() {
 	cout << "snowshoe_init() ran in " << (t1 - t0) << " usec" << endl;
 
 	assert(ec_elligator_test());
+	assert(ec_elligator_batch_test());
+	assert(ec_keygen_elligator_test());
+	assert(ec_hash_to_curve_test());
+	assert(ec_soa_test());
+	assert(ec_keydir_test());
+	assert(ec_msm_test());
+	assert(ec_sig_aggregate_test());
+	assert(ec_musig_test());
+	assert(ec_commit_test());
+	assert(ec_pool_test());
+	assert(ec_ring_test());
+	assert(ec_coalescer_test());
+	assert(ec_elligator_prepared_test());
+	assert(ec_short_test());
+	assert(ec_counts_test());
+	assert(ec_stats_test());
 	assert(ec_dh_test());
 	assert(ec_dh_fs_test());
 	assert(ec_dsa_test());